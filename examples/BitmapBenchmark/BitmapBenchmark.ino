@@ -0,0 +1,177 @@
+/*
+Bitmap benchmark example
+
+Measures the time drawBitmap() takes to draw the boot logo, at a position
+lined up with the display pages and at a position between them. For
+comparison, the same is measured with the byte at a time drawing loop that
+drawBitmap() used before it got a word wide blitter.
+
+It also compares drawing a masked sprite with drawExternalMask(), using
+separate image and mask arrays, and with drawPlusMask(), using a single
+array with the image and mask bytes interleaved.
+
+The results are shown in CPU cycles per call. They depend on the board and
+the compiler version and options, so no figures are given here: run the
+sketch on the target to compare.
+*/
+
+#include <MicroGamer.h>
+#include <ab_logo.c>
+
+MicroGamer mg;
+
+#define ITERATIONS 1000
+
+// A 16x16 ball, as an image and a mask for drawExternalMask()
+const uint8_t PROGMEM ball[] = {
+  16, 16,
+  0x00, 0x00, 0xE0, 0xF8, 0x18, 0xCC, 0xEC, 0xEC,
+  0xEC, 0xEC, 0xCC, 0x18, 0xF8, 0xE0, 0x00, 0x00,
+  0x00, 0x00, 0x07, 0x1F, 0x18, 0x33, 0x37, 0x37,
+  0x37, 0x37, 0x33, 0x18, 0x1F, 0x07, 0x00, 0x00,
+};
+
+const uint8_t PROGMEM ballMask[] = {
+  0xC0, 0xF0, 0xFC, 0xFC, 0xFE, 0xFE, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFE, 0xFE, 0xFC, 0xFC, 0xF0, 0xC0,
+  0x03, 0x0F, 0x3F, 0x3F, 0x7F, 0x7F, 0xFF, 0xFF,
+  0xFF, 0xFF, 0x7F, 0x7F, 0x3F, 0x3F, 0x0F, 0x03,
+};
+
+// The same ball with the image and mask interleaved, for drawPlusMask()
+const uint8_t PROGMEM ballPlusMask[] = {
+  16, 16,
+  0x00, 0xC0, 0x00, 0xF0, 0xE0, 0xFC, 0xF8, 0xFC,
+  0x18, 0xFE, 0xCC, 0xFE, 0xEC, 0xFF, 0xEC, 0xFF,
+  0xEC, 0xFF, 0xEC, 0xFF, 0xCC, 0xFE, 0x18, 0xFE,
+  0xF8, 0xFC, 0xE0, 0xFC, 0x00, 0xF0, 0x00, 0xC0,
+  0x00, 0x03, 0x00, 0x0F, 0x07, 0x3F, 0x1F, 0x3F,
+  0x18, 0x7F, 0x33, 0x7F, 0x37, 0xFF, 0x37, 0xFF,
+  0x37, 0xFF, 0x37, 0xFF, 0x33, 0x7F, 0x18, 0x7F,
+  0x1F, 0x3F, 0x07, 0x3F, 0x00, 0x0F, 0x00, 0x03,
+};
+
+// The previous drawBitmap(), checking the clipping and the color for every
+// byte it draws
+void drawBitmapBytewise(int16_t x, int16_t y, const uint8_t *bitmap,
+                        uint8_t w, uint8_t h, uint8_t color)
+{
+  uint8_t *sBuffer = mg.getBuffer();
+
+  if (x + w < 0 || x > WIDTH - 1 || y + h < 0 || y > HEIGHT - 1)
+    return;
+
+  int yOffset = abs(y) % 8;
+  int sRow = y / 8;
+  if (y < 0) {
+    sRow--;
+    yOffset = 8 - yOffset;
+  }
+  int rows = h / 8;
+  if (h % 8 != 0) rows++;
+  for (int a = 0; a < rows; a++) {
+    int bRow = sRow + a;
+    if (bRow > (HEIGHT / 8) - 1) break;
+    if (bRow > -2) {
+      for (int iCol = 0; iCol < w; iCol++) {
+        if (iCol + x > (WIDTH - 1)) break;
+        if (iCol + x >= 0) {
+          if (bRow >= 0) {
+            if (color == WHITE)
+              sBuffer[(bRow * WIDTH) + x + iCol] |= pgm_read_byte(bitmap + (a * w) + iCol) << yOffset;
+            else if (color == BLACK)
+              sBuffer[(bRow * WIDTH) + x + iCol] &= ~(pgm_read_byte(bitmap + (a * w) + iCol) << yOffset);
+            else
+              sBuffer[(bRow * WIDTH) + x + iCol] ^= pgm_read_byte(bitmap + (a * w) + iCol) << yOffset;
+          }
+          if (yOffset && bRow < (HEIGHT / 8) - 1) {
+            if (color == WHITE)
+              sBuffer[((bRow + 1) * WIDTH) + x + iCol] |= pgm_read_byte(bitmap + (a * w) + iCol) >> (8 - yOffset);
+            else if (color == BLACK)
+              sBuffer[((bRow + 1) * WIDTH) + x + iCol] &= ~(pgm_read_byte(bitmap + (a * w) + iCol) >> (8 - yOffset));
+            else
+              sBuffer[((bRow + 1) * WIDTH) + x + iCol] ^= pgm_read_byte(bitmap + (a * w) + iCol) >> (8 - yOffset);
+          }
+        }
+      }
+    }
+  }
+}
+
+// The things measured
+enum Test {
+  LOGO_BYTEWISE,
+  LOGO_BLITTER,
+  BALL_EXTERNAL_MASK,
+  BALL_PLUS_MASK
+};
+
+// Return the average number of CPU cycles of one call
+unsigned long measure(Test test, int16_t y)
+{
+  unsigned long start = micros();
+
+  for (int i = 0; i < ITERATIONS; i++) {
+    switch (test) {
+      case LOGO_BYTEWISE:
+        drawBitmapBytewise(20, y, arduboy_logo, 88, 16, WHITE);
+        break;
+      case LOGO_BLITTER:
+        mg.drawBitmap(20, y, arduboy_logo, 88, 16, WHITE);
+        break;
+      case BALL_EXTERNAL_MASK:
+        Sprites::drawExternalMask(56, y, ball, ballMask, 0, 0);
+        break;
+      case BALL_PLUS_MASK:
+        Sprites::drawPlusMask(56, y, ballPlusMask, 0);
+        break;
+    }
+  }
+
+  return (micros() - start) * (F_CPU / 1000000) / ITERATIONS;
+}
+
+// Print the cycles of two tests at y = 8 and y = 11, measured as
+// results[0] to results[3], on two lines starting at the given row
+void printResults(int16_t row, const char *label, unsigned long *results)
+{
+  for (uint8_t i = 0; i < 2; i++) {
+    mg.setCursor(0, row + (i * 8));
+    mg.print(label);
+    mg.print(i == 0 ? F(" y=8") : F(" y=11"));
+    mg.setCursor(72, row + (i * 8));
+    mg.print(results[i * 2]);
+    mg.setCursor(102, row + (i * 8));
+    mg.print(results[(i * 2) + 1]);
+  }
+}
+
+void setup() {
+  mg.begin();
+
+  unsigned long logo[4] = {
+    measure(LOGO_BYTEWISE, 8), measure(LOGO_BLITTER, 8),
+    measure(LOGO_BYTEWISE, 11), measure(LOGO_BLITTER, 11)
+  };
+  unsigned long sprite[4] = {
+    measure(BALL_EXTERNAL_MASK, 8), measure(BALL_PLUS_MASK, 8),
+    measure(BALL_EXTERNAL_MASK, 11), measure(BALL_PLUS_MASK, 11)
+  };
+
+  mg.clear();
+  mg.print(F("cycles"));
+  mg.setCursor(72, 0);
+  mg.print(F("old"));
+  mg.setCursor(102, 0);
+  mg.print(F("new"));
+  printResults(8, "logo", logo);
+  mg.setCursor(72, 32);
+  mg.print(F("ext"));
+  mg.setCursor(102, 32);
+  mg.print(F("plus"));
+  printResults(40, "ball", sprite);
+  mg.display();
+}
+
+void loop() {
+}
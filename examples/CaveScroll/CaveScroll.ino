@@ -0,0 +1,55 @@
+/*
+Cave scroll example
+
+A cave that scrolls to the left without being drawn again each frame. The
+display buffer is moved with scroll(), and only the columns that move into
+view on the right are drawn, using the areas scroll() reports. Holding A
+scrolls faster.
+*/
+
+#include <MicroGamer.h>
+
+MicroGamer mg;
+
+// the rows of the ceiling and the floor in the last column drawn
+int16_t ceiling = 8;
+int16_t ground = HEIGHT - 8;
+
+// Draw the next column of the cave at x
+void drawColumn(int16_t x) {
+  ceiling += random(-1, 2);
+  ground += random(-1, 2);
+  ceiling = constrain(ceiling, 2, HEIGHT / 2 - 8);
+  ground = constrain(ground, HEIGHT / 2 + 8, HEIGHT - 2);
+
+  mg.drawFastVLine(x, 0, ceiling, WHITE);
+  mg.drawFastVLine(x, ground, HEIGHT - ground, WHITE);
+}
+
+void setup() {
+  mg.begin();
+  mg.setFrameRate(60);
+  mg.enableDirtyTracking();
+
+  mg.clear();
+  for (int16_t x = 0; x < WIDTH; x++)
+    drawColumn(x);
+}
+
+void loop() {
+  if (!(mg.nextFrame()))
+    return;
+
+  mg.pollButtons();
+
+  Rect exposed[2];
+  uint8_t speed = mg.pressed(A_BUTTON) ? 4 : 1;
+  uint8_t count = mg.scroll(-speed, 0, BLACK, exposed);
+
+  for (uint8_t i = 0; i < count; i++) {
+    for (int16_t x = exposed[i].x; x < exposed[i].x + exposed[i].width; x++)
+      drawColumn(x);
+  }
+
+  mg.display();
+}
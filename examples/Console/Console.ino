@@ -0,0 +1,59 @@
+/*
+Console example
+
+A status screen and a scrolling log drawn with the MicroGamerConsole class.
+The status line is printed every frame, but only the cells whose text
+changes are drawn again, and with dirty region tracking only those are sent
+to the display. Pressing A adds a line to the log, scrolling it when it
+reaches the bottom of the screen.
+*/
+
+#include <MicroGamer.h>
+#include <MicroGamerConsole.h>
+
+MicroGamer mg;
+MicroGamerConsole console(mg);
+
+unsigned int logLines = 0;
+
+void setup() {
+  mg.begin();
+  mg.setFrameRate(30);
+  mg.enableDirtyTracking();
+
+  // the console draws over the whole screen, it isn't cleared each frame
+  mg.clear();
+  console.setCursor(0, 1);
+}
+
+void loop() {
+  if (!(mg.nextFrame()))
+    return;
+
+  mg.pollButtons();
+
+  if (mg.justPressed(A_BUTTON)) {
+    // the log goes on after the status line
+    if (console.getCursorRow() == 0)
+      console.setCursor(0, 1);
+    console.print(F("log line "));
+    console.println(logLines++);
+  }
+
+  uint8_t column = console.getCursorColumn();
+  uint8_t row = console.getCursorRow();
+
+  // the status line, the same text is printed every frame
+  console.setCursor(0, 0);
+  console.setAttributes(CONSOLE_INVERT);
+  console.print(F("time "));
+  console.print(millis() / 1000);
+  console.print(F("s  lines "));
+  console.print(logLines);
+  console.print(F("    "));
+  console.setAttributes(CONSOLE_NORMAL);
+  console.setCursor(column, row);
+
+  console.render();
+  mg.display();
+}
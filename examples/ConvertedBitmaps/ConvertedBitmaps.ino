@@ -0,0 +1,66 @@
+/*
+Converted bitmaps example
+
+Bitmaps written in other formats, converted to the display's page format
+when the sketch is compiled, so they're drawn as fast as any other sprite.
+
+The heart is an array in the horizontal format used by drawSlowXYBitmap()
+and Adafruit GFX bitmaps, converted with XYBitmap. The invader is drawn as
+text, with two animation frames, and converted with AsciiBitmap.
+*/
+
+#include <MicroGamer.h>
+#include <MicroGamerBitmaps.h>
+
+MicroGamer mg;
+
+// A 16x13 heart, 2 bytes for each row
+constexpr uint8_t heartXY[] = {
+  0x3C, 0x78, 0x7E, 0xFC, 0xFF, 0xFE, 0xFF, 0xFE,
+  0xFF, 0xFE, 0xFF, 0xFE, 0x7F, 0xFC, 0x3F, 0xF8,
+  0x1F, 0xF0, 0x0F, 0xE0, 0x07, 0xC0, 0x03, 0x80,
+  0x01, 0x00,
+};
+typedef XYBitmap<heartXY, 16, 13> Heart;
+
+// An 11x8 invader with 2 frames
+constexpr char invaderArt[] =
+  "..#.....#.."
+  "...#...#..."
+  "..#######.."
+  ".##.###.##."
+  "###########"
+  "#.#######.#"
+  "#.#.....#.#"
+  "...##.##..."
+
+  "..#.....#.."
+  "#..#...#..#"
+  "#.#######.#"
+  "###.###.###"
+  "###########"
+  ".#########."
+  "..#.....#.."
+  ".#.......#.";
+typedef AsciiBitmap<invaderArt, 11, 8, 2> Invader;
+
+int16_t x = 0;
+
+void setup() {
+  mg.begin();
+  mg.setFrameRate(30);
+}
+
+void loop() {
+  if (!(mg.nextFrame()))
+    return;
+
+  mg.clear();
+
+  mg.drawBitmap(56, 8, Heart::bitmap, 16, 13);
+
+  Sprites::drawSelfMasked(x, 40, Invader::sprite, (mg.frameCount / 8) % 2);
+  x = (x + 1) % WIDTH;
+
+  mg.display();
+}
@@ -0,0 +1,54 @@
+/*
+Dither patterns example
+
+Shows the 17 levels of gray from ditherPattern() as a row of bars, and a
+shaded ball made of circles filled with lighter patterns towards its
+highlight. The ball moves with the arrow buttons. Because patterns are
+lined up with the screen, the circles of the ball and the bars join up
+without seams wherever they are drawn.
+*/
+
+#include <MicroGamer.h>
+
+MicroGamer mg;
+
+int16_t ballX = 64;
+int16_t ballY = 40;
+
+void setup() {
+  mg.begin();
+  mg.setFrameRate(30);
+}
+
+void loop() {
+  if (!(mg.nextFrame()))
+    return;
+
+  if (mg.pressed(LEFT_BUTTON) && ballX > 0)
+    ballX--;
+  if (mg.pressed(RIGHT_BUTTON) && ballX < WIDTH - 1)
+    ballX++;
+  if (mg.pressed(UP_BUTTON) && ballY > 0)
+    ballY--;
+  if (mg.pressed(DOWN_BUTTON) && ballY < HEIGHT - 1)
+    ballY++;
+
+  mg.clear();
+
+  // the levels, from black to white
+  for (uint8_t level = 0; level <= 16; level++) {
+    mg.fillRect(level * 7, 0, 7, 12, MicroGamer::ditherPattern(level), WHITE);
+  }
+
+  // a background for the ball, then the ball from its darkest outer ring
+  // to its highlight
+  mg.fillRect(0, 16, WIDTH, HEIGHT - 16, MicroGamer::ditherPattern(2), WHITE);
+  for (uint8_t ring = 0; ring < 5; ring++) {
+    uint8_t r = 20 - (ring * 4);
+    mg.fillCircle(ballX - ring, ballY - ring, r, BLACK);
+    mg.fillCircle(ballX - ring, ballY - ring, r,
+                  MicroGamer::ditherPattern(4 + (ring * 3)), WHITE);
+  }
+
+  mg.display();
+}
@@ -0,0 +1,180 @@
+/*
+Shape benchmark example
+
+Measures the time drawCircle() and fillCircle() take for radii from 4 to 32.
+For comparison, the same is measured with the midpoint loops they used
+before they were drawn as spans, which set one pixel at a time with
+drawPixel().
+
+The results are shown in CPU cycles per call, for the outlines first.
+Pressing A switches between the outline and the filled results.
+*/
+
+#include <MicroGamer.h>
+
+MicroGamer mg;
+
+#define ITERATIONS 100
+#define RADII 4
+
+const uint8_t radii[RADII] = { 4, 8, 16, 32 };
+
+// The previous drawCircle(), drawing the 8 octants a pixel at a time
+void drawCirclePixels(int16_t x0, int16_t y0, uint8_t r, uint8_t color)
+{
+  int16_t f = 1 - r;
+  int16_t ddF_x = 1;
+  int16_t ddF_y = -2 * r;
+  int16_t x = 0;
+  int16_t y = r;
+
+  mg.drawPixel(x0, y0 + r, color);
+  mg.drawPixel(x0, y0 - r, color);
+  mg.drawPixel(x0 + r, y0, color);
+  mg.drawPixel(x0 - r, y0, color);
+
+  while (x < y) {
+    if (f >= 0) {
+      y--;
+      ddF_y += 2;
+      f += ddF_y;
+    }
+    x++;
+    ddF_x += 2;
+    f += ddF_x;
+
+    mg.drawPixel(x0 + x, y0 + y, color);
+    mg.drawPixel(x0 - x, y0 + y, color);
+    mg.drawPixel(x0 + x, y0 - y, color);
+    mg.drawPixel(x0 - x, y0 - y, color);
+    mg.drawPixel(x0 + y, y0 + x, color);
+    mg.drawPixel(x0 - y, y0 + x, color);
+    mg.drawPixel(x0 + y, y0 - x, color);
+    mg.drawPixel(x0 - y, y0 - x, color);
+  }
+}
+
+// A vertical line a pixel at a time, as drawFastVLine() drew it
+void drawLinePixels(int16_t x, int16_t y, int16_t h, uint8_t color)
+{
+  for (int16_t i = y; i < y + h; i++) {
+    mg.drawPixel(x, i, color);
+  }
+}
+
+// The previous fillCircle(), drawing vertical lines for each step
+void fillCirclePixels(int16_t x0, int16_t y0, uint8_t r, uint8_t color)
+{
+  int16_t f = 1 - r;
+  int16_t ddF_x = 1;
+  int16_t ddF_y = -2 * r;
+  int16_t x = 0;
+  int16_t y = r;
+
+  drawLinePixels(x0, y0 - r, (2 * r) + 1, color);
+
+  while (x < y) {
+    if (f >= 0) {
+      y--;
+      ddF_y += 2;
+      f += ddF_y;
+    }
+    x++;
+    ddF_x += 2;
+    f += ddF_x;
+
+    drawLinePixels(x0 + x, y0 - y, (2 * y) + 1, color);
+    drawLinePixels(x0 + y, y0 - x, (2 * x) + 1, color);
+    drawLinePixels(x0 - x, y0 - y, (2 * y) + 1, color);
+    drawLinePixels(x0 - y, y0 - x, (2 * x) + 1, color);
+  }
+}
+
+// The things measured
+enum Test {
+  DRAW_PIXELS,
+  DRAW_SPANS,
+  FILL_PIXELS,
+  FILL_SPANS
+};
+
+// The cycles of each test for each radius
+unsigned long results[4][RADII];
+bool showFilled = false;
+
+// Return the average number of CPU cycles of one call
+unsigned long measure(Test test, uint8_t r)
+{
+  unsigned long start = micros();
+
+  for (int i = 0; i < ITERATIONS; i++) {
+    switch (test) {
+      case DRAW_PIXELS:
+        drawCirclePixels(64, 32, r, WHITE);
+        break;
+      case DRAW_SPANS:
+        mg.drawCircle(64, 32, r, WHITE);
+        break;
+      case FILL_PIXELS:
+        fillCirclePixels(64, 32, r, WHITE);
+        break;
+      case FILL_SPANS:
+        mg.fillCircle(64, 32, r, WHITE);
+        break;
+    }
+  }
+
+  return (micros() - start) * (F_CPU / 1000000) / ITERATIONS;
+}
+
+// Show the results of the outlines or the filled circles, old and new
+void showResults()
+{
+  Test old = showFilled ? FILL_PIXELS : DRAW_PIXELS;
+
+  mg.clear();
+  mg.print(showFilled ? F("fill") : F("draw"));
+  mg.setCursor(36, 0);
+  mg.print(F("old"));
+  mg.setCursor(84, 0);
+  mg.print(F("new"));
+
+  for (uint8_t i = 0; i < RADII; i++) {
+    mg.setCursor(0, (i + 1) * 8);
+    mg.print(F("r="));
+    mg.print(radii[i]);
+    mg.setCursor(36, (i + 1) * 8);
+    mg.print(results[old][i]);
+    mg.setCursor(84, (i + 1) * 8);
+    mg.print(results[old + 1][i]);
+  }
+
+  mg.setCursor(0, 56);
+  mg.print(F("A: "));
+  mg.print(showFilled ? F("outlines") : F("filled"));
+  mg.display();
+}
+
+void setup() {
+  mg.begin();
+
+  for (uint8_t test = DRAW_PIXELS; test <= FILL_SPANS; test++) {
+    for (uint8_t i = 0; i < RADII; i++) {
+      results[test][i] = measure((Test)test, radii[i]);
+    }
+  }
+
+  showResults();
+}
+
+void loop() {
+  if (!(mg.nextFrame()))
+    return;
+
+  mg.pollButtons();
+
+  if (mg.justPressed(A_BUTTON)) {
+    showFilled = !showFilled;
+    showResults();
+  }
+}
@@ -0,0 +1,76 @@
+/*
+Split screen example
+
+The same world drawn twice, in the left and right halves of the screen,
+each half with its own camera. The world is drawn by a single function in
+world coordinates: setViewport() clips each half so that nothing spills
+over into the other, and setOrigin() moves the world under the camera.
+The arrow buttons move the ball, which the left camera follows, while the
+right camera stays on the right end of the world.
+*/
+
+#include <MicroGamer.h>
+
+MicroGamer mg;
+
+#define WORLD_WIDTH 160
+#define WORLD_HEIGHT 64
+#define VIEW_WIDTH 63
+
+int16_t ballX = 20;
+int16_t ballY = 32;
+
+// The world, drawn with its top left corner at the origin
+void drawWorld() {
+  mg.drawRect(0, 0, WORLD_WIDTH, WORLD_HEIGHT);
+  for (int16_t x = 16; x < WORLD_WIDTH; x += 32) {
+    mg.fillRect(x, 40, 8, 24);
+    mg.drawCircle(x + 16, 16, 6);
+  }
+  mg.fillCircle(ballX, ballY, 3);
+}
+
+// Draw the world in the half of the screen starting at viewX, with the
+// world position cameraX at its left edge
+void drawView(int16_t viewX, int16_t cameraX) {
+  mg.setViewport(viewX, 0, VIEW_WIDTH, HEIGHT);
+  mg.setOrigin(viewX - cameraX, 0);
+  drawWorld();
+}
+
+void setup() {
+  mg.begin();
+  mg.setFrameRate(30);
+}
+
+void loop() {
+  if (!(mg.nextFrame()))
+    return;
+
+  if (mg.pressed(LEFT_BUTTON) && ballX > 4)
+    ballX--;
+  if (mg.pressed(RIGHT_BUTTON) && ballX < WORLD_WIDTH - 5)
+    ballX++;
+  if (mg.pressed(UP_BUTTON) && ballY > 4)
+    ballY--;
+  if (mg.pressed(DOWN_BUTTON) && ballY < WORLD_HEIGHT - 5)
+    ballY++;
+
+  // the left camera keeps the ball in the middle of its view
+  int16_t cameraX = ballX - (VIEW_WIDTH / 2);
+  if (cameraX < 0)
+    cameraX = 0;
+  if (cameraX > WORLD_WIDTH - VIEW_WIDTH)
+    cameraX = WORLD_WIDTH - VIEW_WIDTH;
+
+  mg.clear();
+
+  drawView(0, cameraX);
+  drawView(WIDTH - VIEW_WIDTH, WORLD_WIDTH - VIEW_WIDTH);
+
+  // back to the whole screen, for the line between the views
+  mg.setViewport(0, 0, WIDTH, HEIGHT);
+  mg.drawFastVLine(WIDTH / 2, 0, HEIGHT);
+
+  mg.display();
+}
@@ -0,0 +1,72 @@
+/*
+Sprite transforms example
+
+A single arrow sprite drawn facing all four directions, and at 2 to 4 times
+its size, without storing any of those variants. The arrow at the top left turns with the arrow buttons and
+follows them around the screen.
+*/
+
+#include <MicroGamer.h>
+
+MicroGamer mg;
+
+// An 8x8 arrow pointing right
+const uint8_t PROGMEM arrow[] = {
+  8, 8,
+  0x18, 0x18, 0x18, 0x18, 0xFF, 0x7E, 0x3C, 0x18,
+};
+
+// The transforms that turn the arrow to point right, down, left and up
+const uint8_t directions[] = {
+  0, SPRITE_ROTATE_90, SPRITE_MIRROR, SPRITE_ROTATE_270
+};
+
+int16_t x = 0;
+int16_t y = 0;
+uint8_t direction = 0;
+
+void setup() {
+  mg.begin();
+  mg.setFrameRate(30);
+}
+
+void loop() {
+  if (!(mg.nextFrame()))
+    return;
+
+  mg.pollButtons();
+
+  if (mg.pressed(RIGHT_BUTTON)) {
+    direction = 0;
+    x++;
+  }
+  else if (mg.pressed(DOWN_BUTTON)) {
+    direction = 1;
+    y++;
+  }
+  else if (mg.pressed(LEFT_BUTTON)) {
+    direction = 2;
+    x--;
+  }
+  else if (mg.pressed(UP_BUTTON)) {
+    direction = 3;
+    y--;
+  }
+
+  mg.clear();
+
+  // the arrow in each direction
+  for (uint8_t i = 0; i < 4; i++) {
+    Sprites::drawSelfMasked(80 + (i * 12), 0, arrow, 0, directions[i]);
+  }
+
+  // the arrow at 2, 3 and 4 times its size
+  for (uint8_t scale = 2; scale <= 4; scale++) {
+    Sprites::drawOverwrite((scale - 2) * 40 + 8, 24, arrow, 0,
+                           directions[direction], scale);
+  }
+
+  Sprites::drawSelfMasked(x, y, arrow, 0, directions[direction]);
+
+  mg.display();
+}
@@ -0,0 +1,70 @@
+/*
+Surface layers example
+
+A starfield background and a status bar are drawn once on offscreen
+surfaces. Each frame, they are copied onto the display buffer with
+drawSurface() and a ship is drawn over them, instead of drawing all the
+stars and the status bar again. The status bar is only drawn again when
+the score changes. Pressing A adds to the score.
+*/
+
+#include <MicroGamer.h>
+
+MicroGamer mg;
+
+// the background covers the screen, the status bar its top 16 rows
+uint8_t backgroundPixels[WIDTH * (HEIGHT / 8)];
+Surface background = { backgroundPixels, WIDTH, HEIGHT / 8 };
+
+uint8_t statusPixels[WIDTH * 2];
+Surface status = { statusPixels, WIDTH, 2 };
+
+unsigned int score = 0;
+int16_t shipX = 60;
+
+void drawStatus() {
+  mg.setRenderTarget(&status);
+  mg.clear();
+  mg.drawRect(0, 0, WIDTH, 16);
+  mg.setCursor(4, 4);
+  mg.print(F("SCORE "));
+  mg.print(score);
+  mg.setRenderTarget(NULL);
+}
+
+void setup() {
+  mg.begin();
+  mg.setFrameRate(30);
+
+  mg.setRenderTarget(&background);
+  mg.clear();
+  for (uint8_t i = 0; i < 60; i++) {
+    mg.drawPixel(random(WIDTH), random(16, HEIGHT));
+  }
+  mg.fillRect(0, HEIGHT - 8, WIDTH, 8, MicroGamer::ditherPattern(6), WHITE);
+  mg.setRenderTarget(NULL);
+
+  drawStatus();
+}
+
+void loop() {
+  if (!(mg.nextFrame()))
+    return;
+
+  mg.pollButtons();
+  if (mg.justPressed(A_BUTTON)) {
+    score += 10;
+    drawStatus();
+  }
+  if (mg.pressed(LEFT_BUTTON) && shipX > 0)
+    shipX--;
+  if (mg.pressed(RIGHT_BUTTON) && shipX < WIDTH - 8)
+    shipX++;
+
+  // the layers replace everything on the screen, so it isn't cleared
+  mg.drawSurface(0, 0, &background);
+  mg.drawSurface(0, 0, &status);
+  mg.fillTriangle(shipX, 50, shipX + 7, 50, shipX + 3, 42);
+
+  mg.display();
+}
@@ -0,0 +1,76 @@
+/*
+Tilemap scroll example
+
+A level of 8x8 tiles, larger than the screen, drawn with drawTilemap() and
+scrolled with the arrow buttons. The whole screen is drawn from the map
+each frame, so it isn't cleared. The water tiles are animated through a
+frame table.
+*/
+
+#include <MicroGamer.h>
+
+MicroGamer mg;
+
+// 8x8 tiles: empty, brick, grass, and 3 frames of water
+const uint8_t PROGMEM tiles[] = {
+  8, 8,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0xEF, 0xEF, 0xEF, 0x00, 0xFE, 0xFE, 0xFE, 0x00,
+  0x03, 0x0D, 0x03, 0x05, 0x03, 0x09, 0x05, 0x03,
+  0x22, 0x11, 0x22, 0x44, 0x22, 0x11, 0x22, 0x44,
+  0x11, 0x22, 0x44, 0x22, 0x11, 0x22, 0x44, 0x22,
+  0x44, 0x22, 0x11, 0x22, 0x44, 0x22, 0x11, 0x22,
+};
+
+// tile 3 is the first of 3 frames of water
+const uint8_t PROGMEM frames[] = { 1, 1, 1, 3, 1, 1 };
+
+#define LEVEL_WIDTH 32
+#define LEVEL_HEIGHT 12
+
+const uint8_t PROGMEM level[LEVEL_WIDTH * LEVEL_HEIGHT] = {
+  1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+  1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+  1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 0, 0, 0, 0, 0, 0, 1,
+  1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+  1, 0, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+  1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1,
+  1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+  1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+  1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+  1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 2, 2, 2, 2, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 3, 3, 3, 3, 1, 1, 1, 1, 1, 1, 1, 3, 3, 3, 3, 3, 1, 1, 1, 1, 1,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+};
+
+Tilemap levelMap = { tiles, level, LEVEL_WIDTH, LEVEL_HEIGHT, frames };
+
+int16_t cameraX = 0;
+int16_t cameraY = 0;
+uint8_t tick = 0;
+
+void setup() {
+  mg.begin();
+  mg.setFrameRate(30);
+}
+
+void loop() {
+  if (!(mg.nextFrame()))
+    return;
+
+  if (mg.pressed(LEFT_BUTTON) && cameraX > 0)
+    cameraX--;
+  if (mg.pressed(RIGHT_BUTTON) && cameraX < (LEVEL_WIDTH * 8) - WIDTH)
+    cameraX++;
+  if (mg.pressed(UP_BUTTON) && cameraY > 0)
+    cameraY--;
+  if (mg.pressed(DOWN_BUTTON) && cameraY < (LEVEL_HEIGHT * 8) - HEIGHT)
+    cameraY++;
+
+  // the water moves on every 8 frames
+  if (mg.everyXFrames(8))
+    tick++;
+
+  mg.drawTilemap(&levelMap, cameraX, cameraY, tick);
+  mg.display();
+}
@@ -12,9 +12,174 @@
 //========== class MicroGamerBase ==========
 //==========================================
 
-uint8_t MicroGamerBase::staticAllocatedBuffer[];
-uint8_t *MicroGamerBase::displayBuffer;
+#if MICROGAMER_DISPLAY_LIST_SIZE
+uint8_t MicroGamerBase::displayList[];
+uint16_t MicroGamerBase::displayListLength;
+MicroGamerBase::ViewState MicroGamerBase::displayListView;
+bool MicroGamerBase::displayListFull;
+bool MicroGamerBase::replayingDisplayList;
+uint8_t MicroGamerBase::displayListStripes[][WIDTH];
+#else
+uint8_t MicroGamerBase::staticAllocatedBuffer[][(HEIGHT*WIDTH)/8];
+#endif
+#if MICROGAMER_SPRITE_CACHE_SIZE
+uint8_t MicroGamerBase::spriteCache[];
+MicroGamerBase::SpriteCacheEntry MicroGamerBase::spriteCacheEntries[];
+uint8_t MicroGamerBase::spriteCacheCount;
+uint16_t MicroGamerBase::spriteCacheUsed;
+unsigned long MicroGamerBase::spriteCacheHitCount;
+unsigned long MicroGamerBase::spriteCacheMissCount;
+#endif
 uint8_t *MicroGamerBase::sBuffer;
+MicroGamerBase::ViewState MicroGamerBase::view = { 0, 0, WIDTH, HEIGHT, 0, 0 };
+int16_t MicroGamerBase::bandTop;
+int16_t MicroGamerBase::bandBottom = HEIGHT;
+int16_t MicroGamerBase::clipLeft;
+int16_t MicroGamerBase::clipRight = WIDTH;
+int16_t MicroGamerBase::clipTop;
+int16_t MicroGamerBase::clipBottom = HEIGHT;
+const uint8_t *MicroGamerBase::fillPattern;
+Surface *MicroGamerBase::renderTarget;
+int16_t MicroGamerBase::targetWidth = WIDTH;
+int16_t MicroGamerBase::targetHeight = HEIGHT;
+uint8_t *MicroGamerBase::screenBuffer;
+
+uint8_t *MicroGamerBase::frameBuffers[];
+uint8_t MicroGamerBase::frameBufferCount;
+bool MicroGamerBase::dropFrames;
+unsigned long MicroGamerBase::framesDroppedCount;
+
+bool MicroGamerBase::trackDirty;
+PageSpans MicroGamerBase::dirty;
+PageSpans MicroGamerBase::drawnSpans[];
+PageSpans MicroGamerBase::pendingSpans[];
+PageSpans MicroGamerBase::displayedSpans;
+PageSpans MicroGamerBase::resendSpans;
+uint8_t MicroGamerBase::bufferIndex;
+uint8_t MicroGamerBase::displayedIndex;
+uint8_t MicroGamerBase::previousDisplayedIndex;
+uint16_t MicroGamerBase::lastDisplayByteCount;
+unsigned long MicroGamerBase::displayBytesSavedCount;
+uint8_t MicroGamerBase::startLine;
+bool MicroGamerBase::startLineChanged;
+bool MicroGamerBase::startLineQueued;
+
+// Approximate number of bytes it costs on the bus to set up one more window
+// for a partial display update: the address, control byte and 6 command
+// bytes of the command transaction plus the address and control byte of the
+// data transaction, with the start and stop conditions.
+#define DISPLAY_WINDOW_OVERHEAD 12
+
+/* Dirty region tracking */
+
+static void spansClear(PageSpans *spans)
+{
+  memset(spans->first, WIDTH, sizeof(spans->first));
+  memset(spans->last, 0, sizeof(spans->last));
+}
+
+static void spansFill(PageSpans *spans)
+{
+  memset(spans->first, 0, sizeof(spans->first));
+  memset(spans->last, WIDTH - 1, sizeof(spans->last));
+}
+
+static inline void spansMark(PageSpans *spans, uint8_t page,
+                             uint8_t first, uint8_t last)
+{
+  if (first < spans->first[page])
+    spans->first[page] = first;
+  if (last > spans->last[page])
+    spans->last[page] = last;
+}
+
+inline void MicroGamerBase::markDrawn(uint8_t page, uint8_t first,
+                                      uint8_t last)
+{
+  if (renderTarget == NULL)
+    spansMark(&dirty, page, first, last);
+}
+
+// Add the spans of src to dest
+static void spansAdd(PageSpans *dest, const PageSpans *src)
+{
+  for (uint8_t page = 0; page < HEIGHT / 8; page++) {
+    if (src->first[page] <= src->last[page]) {
+      spansMark(dest, page, src->first[page], src->last[page]);
+    }
+  }
+}
+
+// Shrink the spans to the columns where the two images differ
+static void spansTrim(PageSpans *spans, const uint8_t *image,
+                      const uint8_t *other)
+{
+  for (uint8_t page = 0; page < HEIGHT / 8; page++) {
+    const uint8_t *a = image + (page * WIDTH);
+    const uint8_t *b = other + (page * WIDTH);
+    uint8_t first = spans->first[page];
+    uint8_t last = spans->last[page];
+
+    while (first <= last && a[first] == b[first])
+      first++;
+    while (last > first && a[last] == b[last])
+      last--;
+
+    if (first > last) {
+      first = WIDTH;
+      last = 0;
+    }
+    spans->first[page] = first;
+    spans->last[page] = last;
+  }
+}
+
+// Group the spans into as few windows as is worth it, merging a page into
+// the previous window when sending the extra bytes is cheaper than setting
+// up a new window. Returns the number of windows and the bytes they hold.
+static uint8_t spansToWindows(const PageSpans *spans, DisplayWindow *windows,
+                              uint16_t *bytes)
+{
+  DisplayWindow *window = NULL;
+  uint16_t windowBytes = 0;
+  uint8_t count = 0;
+
+  *bytes = 0;
+  for (uint8_t page = 0; page < HEIGHT / 8; page++) {
+    uint8_t first = spans->first[page];
+    uint8_t last = spans->last[page];
+
+    if (first > last)
+      continue;
+
+    if (window != NULL) {
+      uint8_t mergedFirst = min(first, window->firstColumn);
+      uint8_t mergedLast = max(last, window->lastColumn);
+      uint16_t mergedBytes = (page - window->firstPage + 1) *
+                             (mergedLast - mergedFirst + 1);
+
+      if (mergedBytes <= windowBytes + (last - first + 1) +
+                         DISPLAY_WINDOW_OVERHEAD) {
+        window->firstColumn = mergedFirst;
+        window->lastColumn = mergedLast;
+        window->lastPage = page;
+        windowBytes = mergedBytes;
+        continue;
+      }
+      *bytes += windowBytes;
+    }
+
+    window = &windows[count++];
+    window->firstColumn = first;
+    window->lastColumn = last;
+    window->firstPage = page;
+    window->lastPage = page;
+    windowBytes = last - first + 1;
+  }
+  *bytes += windowBytes;
+
+  return count;
+}
 
 MicroGamerBase::MicroGamerBase()
 {
@@ -28,9 +193,46 @@ MicroGamerBase::MicroGamerBase()
   // init not necessary, will be reset after first use
   // lastFrameStart
   // lastFrameDurationMs
-
-  sBuffer = staticAllocatedBuffer;
-  displayBuffer = NULL;
+  busWaitMicros = 0;
+  lastBusWaitMicros = 0;
+
+#if MICROGAMER_DISPLAY_LIST_SIZE
+  // there is no frame buffer, sBuffer only points to a page while it's drawn
+  frameBuffers[0] = displayListStripes[0];
+  displayListLength = 0;
+  displayListFull = false;
+  replayingDisplayList = false;
+#else
+  for (uint8_t i = 0; i < MICROGAMER_FRAME_BUFFERS; i++) {
+    frameBuffers[i] = staticAllocatedBuffer[i];
+  }
+#endif
+  frameBufferCount = MICROGAMER_FRAME_BUFFERS;
+  bufferIndex = 0;
+  displayedIndex = 0;
+  previousDisplayedIndex = 0;
+  sBuffer = frameBuffers[0];
+  view.left = 0;
+  view.top = 0;
+  view.right = WIDTH;
+  view.bottom = HEIGHT;
+  view.originX = 0;
+  view.originY = 0;
+#if MICROGAMER_DISPLAY_LIST_SIZE
+  displayListView = view;
+#endif
+  bandTop = 0;
+  bandBottom = HEIGHT;
+  updateClip();
+  dropFrames = false;
+  framesDroppedCount = 0;
+
+  trackDirty = false;
+  spansClear(&dirty);
+  spansClear(&resendSpans);
+  startLine = 0;
+  startLineChanged = false;
+  startLineQueued = false;
 }
 
 // functions called here should be public so users can create their
@@ -222,6 +424,8 @@ bool MicroGamerBase::nextFrame()
 
   // pre-render
   justRendered = true;
+  lastBusWaitMicros = busWaitMicros;
+  busWaitMicros = 0;
   lastFrameStart = now;
   nextFrameStart = now + eachFrameMillis;
   frameCount++;
@@ -247,6 +451,11 @@ int MicroGamerBase::cpuLoad()
   return lastFrameDurationMs*100 / eachFrameMillis;
 }
 
+int MicroGamerBase::busWaitLoad()
+{
+  return lastBusWaitMicros / (eachFrameMillis * 10);
+}
+
 void MicroGamerBase::initRandomSeed()
 {
   // power_adc_enable(); // ADC on
@@ -267,7 +476,40 @@ void MicroGamerBase::initRandomSeed()
 
 void MicroGamerBase::clear()
 {
-  fillScreen(BLACK);
+  if (renderTarget != NULL) {
+    memset(sBuffer, 0, renderTarget->width * renderTarget->pages);
+    return;
+  }
+
+#if MICROGAMER_DISPLAY_LIST_SIZE
+  // start a new frame, from the view it's left with
+  displayListLength = 0;
+  displayListFull = false;
+  displayListView = view;
+  return;
+#endif
+
+  if (!trackDirty) {
+    // the whole screen, whatever the clip rectangle
+    memset(sBuffer, 0, WIDTH * HEIGHT / 8);
+    for (uint8_t page = 0; page < HEIGHT / 8; page++)
+      markDrawn(page, 0, WIDTH - 1);
+    return;
+  }
+
+  // only clear what was drawn since the last clear
+  PageSpans *drawn = &drawnSpans[bufferIndex];
+
+  spansAdd(drawn, &dirty);
+  for (uint8_t page = 0; page < HEIGHT / 8; page++) {
+    if (drawn->first[page] <= drawn->last[page]) {
+      memset(sBuffer + (page * WIDTH) + drawn->first[page], 0,
+             drawn->last[page] - drawn->first[page] + 1);
+    }
+  }
+  spansAdd(&pendingSpans[bufferIndex], drawn);
+  spansClear(drawn);
+  spansClear(&dirty);
 }
 
 
@@ -280,198 +522,430 @@ void MicroGamerBase::clear()
 
 void MicroGamerBase::drawPixel(int16_t x, int16_t y, uint8_t color)
 {
-  if ((x < 0) || (x >= width()) || (y < 0) || (y >= height())) {
+  int16_t args[] = { x, y, color };
+
+  x += view.originX;
+  y += view.originY;
+  if ((x < clipLeft) || (x >= clipRight) || (y < clipTop) || (y >= clipBottom)) {
     return;
   }
 
+  if (recordDrawCall(DL_DRAW_PIXEL, args[1], args[1], args, 3))
+    return;
+
   // x is which column
   switch (color)
   {
-    case WHITE:   sBuffer[x+ (y/8)*WIDTH] |=  (1 << (y&7)); break;
-    case BLACK:   sBuffer[x+ (y/8)*WIDTH] &= ~(1 << (y&7)); break;
-    case INVERSE: sBuffer[x+ (y/8)*WIDTH] ^=  (1 << (y&7)); break;
+    case WHITE:   sBuffer[x+ (y/8)*targetWidth] |=  (1 << (y&7)); break;
+    case BLACK:   sBuffer[x+ (y/8)*targetWidth] &= ~(1 << (y&7)); break;
+    case INVERSE: sBuffer[x+ (y/8)*targetWidth] ^=  (1 << (y&7)); break;
   }
+
+  markDrawn(y / 8, x, x);
 }
 
 uint8_t MicroGamerBase::getPixel(uint8_t x, uint8_t y)
 {
-  uint8_t row = y / 8;
-  uint8_t bit_position = y % 8;
-  return (sBuffer[(row*WIDTH) + x] & bit_position) >> bit_position;
+  int16_t column = x + view.originX;
+  int16_t row = y + view.originY;
+
+  if (column < 0 || column >= targetWidth || row < 0 || row >= targetHeight)
+    return BLACK;
+
+  return (sBuffer[((row / 8) * targetWidth) + column] >> (row % 8)) & 1;
 }
 
 void MicroGamerBase::drawCircle(int16_t x0, int16_t y0, uint8_t r, uint8_t color)
 {
-  int16_t f = 1 - r;
-  int16_t ddF_x = 1;
-  int16_t ddF_y = -2 * r;
-  int16_t x = 0;
-  int16_t y = r;
-
-  drawPixel(x0, y0+r, color);
-  drawPixel(x0, y0-r, color);
-  drawPixel(x0+r, y0, color);
-  drawPixel(x0-r, y0, color);
-
-  while (x<y)
-  {
-    if (f >= 0)
-    {
-      y--;
-      ddF_y += 2;
-      f += ddF_y;
-    }
-
-    x++;
-    ddF_x += 2;
-    f += ddF_x;
+  int16_t args[] = { x0, y0, r, color };
+  if (recordDrawCall(DL_DRAW_CIRCLE, y0 - r, y0 + r, args, 4))
+    return;
 
-    drawPixel(x0 + x, y0 + y, color);
-    drawPixel(x0 - x, y0 + y, color);
-    drawPixel(x0 + x, y0 - y, color);
-    drawPixel(x0 - x, y0 - y, color);
-    drawPixel(x0 + y, y0 + x, color);
-    drawPixel(x0 - y, y0 + x, color);
-    drawPixel(x0 + y, y0 - x, color);
-    drawPixel(x0 - y, y0 - x, color);
-  }
+  drawEllipseCorners(x0, y0, x0, y0, r, r, 0xF, true, color);
 }
 
 void MicroGamerBase::drawCircleHelper
 (int16_t x0, int16_t y0, uint8_t r, uint8_t corners, uint8_t color)
 {
-  int16_t f = 1 - r;
-  int16_t ddF_x = 1;
-  int16_t ddF_y = -2 * r;
-  int16_t x = 0;
-  int16_t y = r;
-
-  while (x<y)
-  {
-    if (f >= 0)
-    {
-      y--;
-      ddF_y += 2;
-      f += ddF_y;
-    }
-
-    x++;
-    ddF_x += 2;
-    f += ddF_x;
+  int16_t args[] = { x0, y0, r, corners, color };
+  if (recordDrawCall(DL_DRAW_CIRCLE_HELPER, y0 - r, y0 + r, args, 5))
+    return;
 
-    if (corners & 0x4) // lower right
-    {
-      drawPixel(x0 + x, y0 + y, color);
-      drawPixel(x0 + y, y0 + x, color);
+  // the only pixels of a corner with a radius of 1 are on the axes
+  if (r == 1) {
+    if (corners & 0x1) {
+      drawPixel(x0 - 1, y0, color);
+      drawPixel(x0, y0 - 1, color);
     }
-    if (corners & 0x2) // upper right
-    {
-      drawPixel(x0 + x, y0 - y, color);
-      drawPixel(x0 + y, y0 - x, color);
+    if (corners & 0x2) {
+      drawPixel(x0 + 1, y0, color);
+      drawPixel(x0, y0 - 1, color);
     }
-    if (corners & 0x8) // lower left
-    {
-      drawPixel(x0 - y, y0 + x, color);
-      drawPixel(x0 - x, y0 + y, color);
+    if (corners & 0x4) {
+      drawPixel(x0 + 1, y0, color);
+      drawPixel(x0, y0 + 1, color);
     }
-    if (corners & 0x1) // upper left
-    {
-      drawPixel(x0 - y, y0 - x, color);
-      drawPixel(x0 - x, y0 - y, color);
+    if (corners & 0x8) {
+      drawPixel(x0 - 1, y0, color);
+      drawPixel(x0, y0 + 1, color);
     }
+    return;
   }
+
+  drawEllipseCorners(x0, y0, x0, y0, r, r, corners, false, color);
 }
 
 void MicroGamerBase::fillCircle(int16_t x0, int16_t y0, uint8_t r, uint8_t color)
 {
-  drawFastVLine(x0, y0-r, 2*r+1, color);
-  fillCircleHelper(x0, y0, r, 3, 0, color);
+  int16_t args[] = { x0, y0, r, color };
+  if (recordDrawCall(DL_FILL_CIRCLE, y0 - r, y0 + r, args, 4))
+    return;
+
+  fillSpan(x0, y0 - r, x0, y0 + r, color);
+  fillEllipseSides(x0, y0, x0, y0, r, r, 3, color);
+}
+
+void MicroGamerBase::fillCircle
+(int16_t x0, int16_t y0, uint8_t r, const uint8_t *pattern, uint8_t color)
+{
+  int16_t args[] = { x0, y0, r, color };
+  if (recordDrawCall(DL_FILL_CIRCLE_PATTERN, y0 - r, y0 + r, args, 4, pattern))
+    return;
+
+  fillPattern = pattern;
+  fillCircle(x0, y0, r, color);
+  fillPattern = NULL;
 }
 
 void MicroGamerBase::fillCircleHelper
 (int16_t x0, int16_t y0, uint8_t r, uint8_t sides, int16_t delta,
  uint8_t color)
 {
-  int16_t f = 1 - r;
-  int16_t ddF_x = 1;
-  int16_t ddF_y = -2 * r;
-  int16_t x = 0;
-  int16_t y = r;
+  int16_t args[] = { x0, y0, r, sides, delta, color };
+  if (recordDrawCall(DL_FILL_CIRCLE_HELPER, y0 - r, y0 + r + delta, args, 6))
+    return;
 
-  while (x < y)
-  {
-    if (f >= 0)
-    {
-      y--;
-      ddF_y += 2;
-      f += ddF_y;
-    }
+  // a side with a radius of 1 also fills the centre column
+  if (r == 1 && sides != 0)
+    fillSpan(x0, y0 - 1, x0, y0 + 1 + delta, color);
+  fillEllipseSides(x0, y0, x0, y0 + delta, r, r, sides, color);
+}
 
-    x++;
-    ddF_x += 2;
-    f += ddF_x;
+void MicroGamerBase::drawEllipse
+(int16_t x0, int16_t y0, uint8_t rx, uint8_t ry, uint8_t color)
+{
+  int16_t args[] = { x0, y0, rx, ry, color };
+  if (recordDrawCall(DL_DRAW_ELLIPSE, y0 - ry, y0 + ry, args, 5))
+    return;
 
-    if (sides & 0x1) // right side
-    {
-      drawFastVLine(x0+x, y0-y, 2*y+1+delta, color);
-      drawFastVLine(x0+y, y0-x, 2*x+1+delta, color);
-    }
+  if (ry == 0)
+    fillSpan(x0 - rx, y0, x0 + rx, y0, color);
+  else
+    drawEllipseCorners(x0, y0, x0, y0, rx, ry, 0xF, true, color);
+}
 
-    if (sides & 0x2) // left side
-    {
-      drawFastVLine(x0-x, y0-y, 2*y+1+delta, color);
-      drawFastVLine(x0-y, y0-x, 2*x+1+delta, color);
-    }
+void MicroGamerBase::fillEllipse
+(int16_t x0, int16_t y0, uint8_t rx, uint8_t ry, uint8_t color)
+{
+  int16_t args[] = { x0, y0, rx, ry, color };
+  if (recordDrawCall(DL_FILL_ELLIPSE, y0 - ry, y0 + ry, args, 5))
+    return;
+
+  if (ry == 0) {
+    fillSpan(x0 - rx, y0, x0 + rx, y0, color);
+  }
+  else {
+    fillSpan(x0, y0 - ry, x0, y0 + ry, color);
+    fillEllipseSides(x0, y0, x0, y0, rx, ry, 3, color);
+  }
+}
+
+// The sine of each whole degree from 0 to 90, times 1024
+static const int16_t arcSines[91] PROGMEM = {
+  0, 18, 36, 54, 71, 89, 107, 125,
+  143, 160, 178, 195, 213, 230, 248, 265,
+  282, 299, 316, 333, 350, 367, 384, 400,
+  416, 433, 449, 465, 481, 496, 512, 527,
+  543, 558, 573, 587, 602, 616, 630, 644,
+  658, 672, 685, 698, 711, 724, 737, 749,
+  761, 773, 784, 796, 807, 818, 828, 839,
+  849, 859, 868, 878, 887, 896, 904, 912,
+  920, 928, 935, 943, 949, 956, 962, 968,
+  974, 979, 984, 989, 994, 998, 1002, 1005,
+  1008, 1011, 1014, 1016, 1018, 1020, 1022, 1023,
+  1023, 1024, 1024,
+};
+
+// The sine of an angle from 0 to 359 degrees, times 1024
+static int16_t arcSine(int16_t angle)
+{
+  // the second half turn is the first one negated, and each half turn is
+  // the same both sides of 90 degrees
+  bool negative = (angle >= 180);
+
+  if (negative)
+    angle -= 180;
+  if (angle > 90)
+    angle = 180 - angle;
+
+  int16_t sine = pgm_read_word(arcSines + angle);
+  return negative ? -sine : sine;
+}
+
+void MicroGamerBase::drawArc
+(int16_t x0, int16_t y0, uint8_t r, int16_t startAngle, int16_t endAngle,
+ uint8_t color)
+{
+  int16_t args[] = { x0, y0, r, startAngle, endAngle, color };
+  if (recordDrawCall(DL_DRAW_ARC, y0 - r, y0 + r, args, 6))
+    return;
+
+  int16_t sweep = endAngle - startAngle;
+
+  if (sweep >= 360 || sweep <= -360) {
+    drawEllipseCorners(x0, y0, x0, y0, r, r, 0xF, true, color);
+    return;
+  }
+  if (sweep < 0)
+    sweep += 360;
+
+  // the same angle a turn apart gives the same direction
+  startAngle %= 360;
+  if (startAngle < 0)
+    startAngle += 360;
+  endAngle %= 360;
+  if (endAngle < 0)
+    endAngle += 360;
+
+  ArcWedge arc;
+  // the cosine is the sine a quarter turn on
+  arc.startX = arcSine((startAngle + 90) % 360);
+  arc.startY = arcSine(startAngle);
+  arc.endX = arcSine((endAngle + 90) % 360);
+  arc.endY = arcSine(endAngle);
+  arc.x0 = x0;
+  arc.y0 = y0;
+  arc.major = (sweep > 180);
+  drawEllipseCorners(x0, y0, x0, y0, r, r, 0xF, true, color, &arc);
+}
+
+// Find the top and bottom rows of an array of points
+static void pointsRows(const Point *points, uint16_t count,
+                       int16_t *top, int16_t *bottom)
+{
+  *top = points[0].y;
+  *bottom = points[0].y;
+
+  for (uint16_t i = 1; i < count; i++) {
+    if (points[i].y < *top)
+      *top = points[i].y;
+    if (points[i].y > *bottom)
+      *bottom = points[i].y;
   }
 }
 
 void MicroGamerBase::drawLine
 (int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t color)
 {
-  // bresenham's algorithm - thx wikpedia
+  int16_t args[] = { x0, y0, x1, y1, color };
+  if (recordDrawCall(DL_DRAW_LINE, min(y0, y1), max(y0, y1), args, 5))
+    return;
+
+  drawLineSegment(x0, y0, x1, y1, color, false, false);
+}
+
+// Whether two points are at the same place
+static inline bool samePoint(const Point &a, const Point &b)
+{
+  return a.x == b.x && a.y == b.y;
+}
+
+void MicroGamerBase::drawPolyline
+(const Point *points, uint8_t count, uint8_t color)
+{
+  int16_t top, bottom;
+  int16_t args[] = { count, color };
+
+  if (count == 0)
+    return;
+  pointsRows(points, count, &top, &bottom);
+  if (recordDrawCall(DL_DRAW_POLYLINE, top, bottom, args, 2,
+                     (const uint8_t *)points))
+    return;
+
+  if (count == 1) {
+    drawLineSegment(points[0].x, points[0].y, points[0].x, points[0].y,
+                    color, false, false);
+    return;
+  }
+
+  // the lines after the first leave out the point they share with the line
+  // before them, and the last line of a closed shape also leaves out the
+  // first point. Lines of no length at the end draw nothing, so the one
+  // before them is the last.
+  uint8_t last = count - 2;
+  while (last > 0 && samePoint(points[last], points[last + 1]))
+    last--;
+  bool closed = last > 0 && samePoint(points[last + 1], points[0]);
+
+  for (uint8_t i = 0; i + 1 < count; i++) {
+    drawLineSegment(points[i].x, points[i].y, points[i + 1].x, points[i + 1].y,
+                    color, i > 0, closed && i == last);
+  }
+}
+
+void MicroGamerBase::drawLines
+(const Point *points, uint8_t count, uint8_t color)
+{
+  int16_t top, bottom;
+  int16_t args[] = { count, color };
+
+  if (count == 0)
+    return;
+  pointsRows(points, count * 2, &top, &bottom);
+  if (recordDrawCall(DL_DRAW_LINES, top, bottom, args, 2,
+                     (const uint8_t *)points))
+    return;
+
+  for (uint8_t i = 0; i < count; i++, points += 2) {
+    drawLineSegment(points[0].x, points[0].y, points[1].x, points[1].y,
+                    color, false, false);
+  }
+}
+
+void MicroGamerBase::drawLineSegment
+(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t color,
+ bool skipStart, bool skipEnd)
+{
+  int16_t t;
+
+  // the line is clipped and drawn in target coordinates
+  x0 += view.originX;
+  y0 += view.originY;
+  x1 += view.originX;
+  y1 += view.originY;
+
+  // Bresenham's algorithm, stepping along the major axis as x
   bool steep = abs(y1 - y0) > abs(x1 - x0);
   if (steep) {
-    swap(x0, y0);
-    swap(x1, y1);
+    t = x0; x0 = y0; y0 = t;
+    t = x1; x1 = y1; y1 = t;
   }
 
-  if (x0 > x1) {
-    swap(x0, x1);
-    swap(y0, y1);
+  bool reversed = (x0 > x1);
+  if (reversed) {
+    t = x0; x0 = x1; x1 = t;
+    t = y0; y0 = y1; y1 = t;
   }
 
-  int16_t dx, dy;
-  dx = x1 - x0;
-  dy = abs(y1 - y0);
+  int16_t dx = x1 - x0;
+  int16_t dy = abs(y1 - y0);
+  int8_t ystep = (y0 < y1) ? 1 : -1;
+
+  // The pixels are numbered from 0 at (x0, y0) to dx at (x1, y1). Pixel i
+  // is at x0 + i and y0 + (ystep * m), where m is the number of steps the
+  // error term of Bresenham's algorithm has made along y by then. A step is
+  // made from pixel i - 1 to pixel i when i * dy > dx / 2 + (m * dx), so the
+  // first pixel of each value of m can be worked out directly. That gives
+  // the pixels on the display without walking the rest of the line, and the
+  // runs of pixels with the same m, which are drawn as spans.
+  int32_t first = 0;
+  int32_t last = dx;
+  int16_t xFirst = steep ? clipTop : clipLeft;
+  int16_t xLast = steep ? clipBottom - 1 : clipRight - 1;
+  int16_t yFirst = steep ? clipLeft : clipTop;
+  int16_t yLast = steep ? clipRight - 1 : clipBottom - 1;
+
+  if (skipStart) {
+    if (reversed)
+      last--;
+    else
+      first++;
+  }
+  if (skipEnd) {
+    if (reversed)
+      first++;
+    else
+      last--;
+  }
+  if (x0 + first < xFirst)
+    first = xFirst - x0;
+  if (x0 + last > xLast)
+    last = xLast - x0;
 
-  int16_t err = dx / 2;
-  int8_t ystep;
+  // the range of m on the display
+  int32_t low = (ystep > 0) ? yFirst - y0 : y0 - yLast;
+  int32_t high = (ystep > 0) ? yLast - y0 : y0 - yFirst;
 
-  if (y0 < y1)
-  {
-    ystep = 1;
+  if (high < 0 || low > dy)
+    return;
+  if (dy > 0 && low > 0) {
+    int32_t i = (((dx / 2) + ((low - 1) * dx)) / dy) + 1;
+    if (i > first)
+      first = i;
   }
-  else
-  {
-    ystep = -1;
+  if (dy > 0 && high < dy) {
+    int32_t i = ((dx / 2) + (high * dx)) / dy;
+    if (i < last)
+      last = i;
   }
+  if (first > last)
+    return;
 
-  for (; x0 <= x1; x0++)
-  {
-    if (steep)
-    {
-      drawPixel(y0, x0, color);
+  // m at the first pixel drawn
+  int32_t m = 0;
+  if (dy > 0 && first * dy > dx / 2)
+    m = ((first * dy) - (dx / 2) + dx - 1) / dx;
+
+  // The first pixel of the next run, and the remainder of the division it
+  // came from, which is carried like Bresenham's error term from run to run.
+  int32_t next = last + 1;
+  int16_t step = 0;
+  int16_t fraction = 0;
+  int16_t remainder = 0;
+
+  if (dy > 0) {
+    int32_t n = (dx / 2) + (m * dx);
+    next = (n / dy) + 1;
+    remainder = n % dy;
+    step = dx / dy;
+    fraction = dx % dy;
+  }
+
+  for (int32_t i = first; i <= last; m++) {
+    int32_t end = (next - 1 < last) ? next - 1 : last;
+    int16_t y = y0 + (ystep * m);
+
+    if (end == i) {
+      // lines near the diagonal have many runs of a single pixel, which are
+      // quicker to draw directly
+      int16_t x = x0 + i;
+      if (steep) {
+        t = x;
+        x = y;
+        y = t;
+      }
+      uint8_t *dst = &sBuffer[(y / 8) * targetWidth + x];
+      uint8_t bit = 1 << (y & 7);
+      switch (color) {
+        case WHITE: *dst |= bit; break;
+        case BLACK: *dst &= ~bit; break;
+        case INVERSE: *dst ^= bit; break;
+        default: return;
+      }
+      markDrawn(y / 8, x, x);
     }
+    else if (steep)
+      fillTargetSpan(y, x0 + i, y, x0 + end, color);
     else
-    {
-      drawPixel(x0, y0, color);
-    }
-
-    err -= dy;
-    if (err < 0)
-    {
-      y0 += ystep;
-      err += dx;
+      fillTargetSpan(x0 + i, y, x0 + end, y, color);
+
+    i = end + 1;
+    next += step;
+    remainder += fraction;
+    if (remainder >= dy) {
+      remainder -= dy;
+      next++;
     }
   }
 }
@@ -479,117 +953,192 @@ void MicroGamerBase::drawLine
 void MicroGamerBase::drawRect
 (int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t color)
 {
-  drawFastHLine(x, y, w, color);
-  drawFastHLine(x, y+h-1, w, color);
-  drawFastVLine(x, y, h, color);
-  drawFastVLine(x+w-1, y, h, color);
+  int16_t args[] = { x, y, w, h, color };
+  // a zero height rectangle still draws its top and bottom lines
+  if (recordDrawCall(DL_DRAW_RECT, min(y, y + h - 1), max(y, y + h - 1),
+                     args, 5))
+    return;
+
+  // The sides go between the top and bottom lines, so that no pixel is
+  // drawn twice, unless there are no lines.
+  int16_t sideTop = (w > 0) ? y + 1 : y;
+  int16_t sideBottom = (w > 0) ? y + h - 2 : y + h - 1;
+
+  fillSpan(x, y, x + w - 1, y, color);
+  if (h != 1)
+    fillSpan(x, y + h - 1, x + w - 1, y + h - 1, color);
+  fillSpan(x, sideTop, x, sideBottom, color);
+  if (w != 1)
+    fillSpan(x + w - 1, sideTop, x + w - 1, sideBottom, color);
 }
 
 void MicroGamerBase::drawFastVLine
 (int16_t x, int16_t y, uint8_t h, uint8_t color)
 {
-  int end = y+h;
-  for (int a = max(0,y); a < min(end,HEIGHT); a++)
-  {
-    drawPixel(x,a,color);
-  }
+  int16_t args[] = { x, y, h, color };
+  if (recordDrawCall(DL_DRAW_FAST_VLINE, y, y + h - 1, args, 4))
+    return;
+
+  fillSpan(x, y, x, y + h - 1, color);
 }
 
 void MicroGamerBase::drawFastHLine
 (int16_t x, int16_t y, uint8_t w, uint8_t color)
 {
-  int16_t xEnd; // last x point + 1
-
-  // Do y bounds checks
-  if (y < 0 || y >= HEIGHT)
+  int16_t args[] = { x, y, w, color };
+  if (recordDrawCall(DL_DRAW_FAST_HLINE, y, y, args, 4))
     return;
 
-  xEnd = x + w;
+  fillSpan(x, y, x + w - 1, y, color);
+}
 
-  // Check if the entire line is not on the display
-  if (xEnd <= 0 || x >= WIDTH)
+void MicroGamerBase::fillRect
+(int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t color)
+{
+  int16_t args[] = { x, y, w, h, color };
+  if (recordDrawCall(DL_FILL_RECT, y, y + h - 1, args, 5))
     return;
 
-  // Don't start before the left edge
-  if (x < 0)
-    x = 0;
-
-  // Don't end past the right edge
-  if (xEnd > WIDTH)
-    xEnd = WIDTH;
-
-  // calculate actual width (even if unchanged)
-  w = xEnd - x;
-
-  // buffer pointer plus row offset + x offset
-  register uint8_t *pBuf = sBuffer + ((y / 8) * WIDTH) + x;
-
-  // pixel mask
-  register uint8_t mask = 1 << (y & 7);
-
-  switch (color)
-  {
-    case WHITE:
-      while (w--)
-      {
-        *pBuf++ |= mask;
-      }
-      break;
-
-    case BLACK:
-      mask = ~mask;
-      while (w--)
-      {
-        *pBuf++ &= mask;
-      }
-      break;
-  }
+  fillSpan(x, y, x + w - 1, y + h - 1, color);
 }
 
 void MicroGamerBase::fillRect
-(int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t color)
+(int16_t x, int16_t y, uint8_t w, uint8_t h, const uint8_t *pattern,
+ uint8_t color)
 {
-  // stupidest version - update in subclasses if desired!
-  for (int16_t i=x; i<x+w; i++)
-  {
-    drawFastVLine(i, y, h, color);
-  }
+  int16_t args[] = { x, y, w, h, color };
+  if (recordDrawCall(DL_FILL_RECT_PATTERN, y, y + h - 1, args, 5, pattern))
+    return;
+
+  fillPattern = pattern;
+  fillSpan(x, y, x + w - 1, y + h - 1, color);
+  fillPattern = NULL;
 }
 
 void MicroGamerBase::fillScreen(uint8_t color)
 {
-    memset(sBuffer, color ? 0xFF : 0x00, WIDTH*HEIGHT/8);
+    int16_t args[] = { color };
+    if (recordDrawCall(DL_FILL_SCREEN, clipTop - view.originY,
+                       clipBottom - 1 - view.originY, args, 1))
+      return;
+
+    // any color but BLACK and INVERSE fills with white
+    if (color != BLACK && color != INVERSE)
+      color = WHITE;
+    fillTargetSpan(clipLeft, clipTop, clipRight - 1, clipBottom - 1, color);
+}
+
+void MicroGamerBase::fillScreen(const uint8_t *pattern, uint8_t color)
+{
+  int16_t args[] = { color };
+  if (recordDrawCall(DL_FILL_SCREEN_PATTERN, clipTop - view.originY,
+                     clipBottom - 1 - view.originY, args, 1, pattern))
+    return;
+
+  fillPattern = pattern;
+  fillTargetSpan(clipLeft, clipTop, clipRight - 1, clipBottom - 1, color);
+  fillPattern = NULL;
+}
+
+// The levels of ditherPattern(), lit where the 4x4 Bayer matrix
+//   0  8  2 10
+//  12  4 14  6
+//   3 11  1  9
+//  15  7 13  5
+// is less than the level
+static const uint8_t ditherPatterns[17][8] PROGMEM = {
+  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+  { 0x11, 0x00, 0x00, 0x00, 0x11, 0x00, 0x00, 0x00 },
+  { 0x11, 0x00, 0x44, 0x00, 0x11, 0x00, 0x44, 0x00 },
+  { 0x11, 0x00, 0x55, 0x00, 0x11, 0x00, 0x55, 0x00 },
+  { 0x55, 0x00, 0x55, 0x00, 0x55, 0x00, 0x55, 0x00 },
+  { 0x55, 0x22, 0x55, 0x00, 0x55, 0x22, 0x55, 0x00 },
+  { 0x55, 0x22, 0x55, 0x88, 0x55, 0x22, 0x55, 0x88 },
+  { 0x55, 0x22, 0x55, 0xAA, 0x55, 0x22, 0x55, 0xAA },
+  { 0x55, 0xAA, 0x55, 0xAA, 0x55, 0xAA, 0x55, 0xAA },
+  { 0x55, 0xBB, 0x55, 0xAA, 0x55, 0xBB, 0x55, 0xAA },
+  { 0x55, 0xBB, 0x55, 0xEE, 0x55, 0xBB, 0x55, 0xEE },
+  { 0x55, 0xBB, 0x55, 0xFF, 0x55, 0xBB, 0x55, 0xFF },
+  { 0x55, 0xFF, 0x55, 0xFF, 0x55, 0xFF, 0x55, 0xFF },
+  { 0x77, 0xFF, 0x55, 0xFF, 0x77, 0xFF, 0x55, 0xFF },
+  { 0x77, 0xFF, 0xDD, 0xFF, 0x77, 0xFF, 0xDD, 0xFF },
+  { 0x77, 0xFF, 0xFF, 0xFF, 0x77, 0xFF, 0xFF, 0xFF },
+  { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF },
+};
+
+const uint8_t *MicroGamerBase::ditherPattern(uint8_t level)
+{
+  return ditherPatterns[level < 16 ? level : 16];
 }
 
 void MicroGamerBase::drawRoundRect
 (int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t r, uint8_t color)
 {
-  // smarter version
-  drawFastHLine(x+r, y, w-2*r, color); // Top
-  drawFastHLine(x+r, y+h-1, w-2*r, color); // Bottom
-  drawFastVLine(x, y+r, h-2*r, color); // Left
-  drawFastVLine(x+w-1, y+r, h-2*r, color); // Right
-  // draw four corners
-  drawCircleHelper(x+r, y+r, r, 1, color);
-  drawCircleHelper(x+w-r-1, y+r, r, 2, color);
-  drawCircleHelper(x+w-r-1, y+h-r-1, r, 4, color);
-  drawCircleHelper(x+r, y+h-r-1, r, 8, color);
+  int16_t args[] = { x, y, w, h, r, color };
+  // corners that don't fit in the height can draw anywhere
+  bool fits = (h > 2 * r);
+  if (recordDrawCall(DL_DRAW_ROUND_RECT, fits ? y : clipTop - view.originY,
+                     fits ? y + h - 1 : clipBottom - 1 - view.originY, args, 6))
+    return;
+
+  if (w == 0 || h == 0)
+    return;
+
+  // corners with a radius of 1 draw the pixels on their axes, which are the
+  // whole rectangle when it's 2 pixels wide or high
+  if (r == 1 && (w == 2 || h == 2))
+    r = 0;
+
+  drawEllipseCorners(x + r, y + r, x + w - r - 1, y + h - r - 1, r, r, 0xF,
+                     true, color);
 }
 
 void MicroGamerBase::fillRoundRect
 (int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t r, uint8_t color)
 {
-  // smarter version
-  fillRect(x+r, y, w-2*r, h, color);
+  int16_t args[] = { x, y, w, h, r, color };
+  // corners that don't fit in the height can draw anywhere
+  bool fits = (h > 2 * r);
+  if (recordDrawCall(DL_FILL_ROUND_RECT, fits ? y : clipTop - view.originY,
+                     fits ? y + h - 1 : clipBottom - 1 - view.originY, args, 6))
+    return;
 
-  // draw four corners
-  fillCircleHelper(x+w-r-1, y+r, r, 1, h-2*r-1, color);
-  fillCircleHelper(x+r, y+r, r, 2, h-2*r-1, color);
+  if (w == 0 || h == 0)
+    return;
+
+  // corners with a radius of 1 fill their centre columns, which are the
+  // whole rectangle when it's 2 pixels wide
+  if (r == 1 && w == 2)
+    r = 0;
+
+  fillSpan(x + r, y, x + w - r - 1, y + h - 1, color);
+  fillEllipseSides(x + r, y + r, x + w - r - 1, y + h - r - 1, r, r, 3, color);
+}
+
+void MicroGamerBase::fillRoundRect
+(int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t r,
+ const uint8_t *pattern, uint8_t color)
+{
+  int16_t args[] = { x, y, w, h, r, color };
+  bool fits = (h > 2 * r);
+  if (recordDrawCall(DL_FILL_ROUND_RECT_PATTERN, fits ? y : clipTop - view.originY,
+                     fits ? y + h - 1 : clipBottom - 1 - view.originY, args, 6,
+                     pattern))
+    return;
+
+  fillPattern = pattern;
+  fillRoundRect(x, y, w, h, r, color);
+  fillPattern = NULL;
 }
 
 void MicroGamerBase::drawTriangle
 (int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t color)
 {
+  int16_t args[] = { x0, y0, x1, y1, x2, y2, color };
+  if (recordDrawCall(DL_DRAW_TRIANGLE, min(min(y0, y1), y2),
+                     max(max(y0, y1), y2), args, 7))
+    return;
+
   drawLine(x0, y0, x1, y1, color);
   drawLine(x1, y1, x2, y2, color);
   drawLine(x2, y2, x0, y0, color);
@@ -598,344 +1147,2121 @@ void MicroGamerBase::drawTriangle
 void MicroGamerBase::fillTriangle
 (int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t color)
 {
+  int16_t args[] = { x0, y0, x1, y1, x2, y2, color };
+  if (recordDrawCall(DL_FILL_TRIANGLE, min(min(y0, y1), y2),
+                     max(max(y0, y1), y2), args, 7))
+    return;
 
-  int16_t a, b, y, last;
-  // Sort coordinates by Y order (y2 >= y1 >= y0)
-  if (y0 > y1)
-  {
-    swap(y0, y1); swap(x0, x1);
-  }
-  if (y1 > y2)
-  {
-    swap(y2, y1); swap(x2, x1);
-  }
-  if (y0 > y1)
-  {
-    swap(y0, y1); swap(x0, x1);
-  }
+  Point points[] = { { x0, y0 }, { x1, y1 }, { x2, y2 } };
+  fillConvexPolygon(points, 3, color);
+}
 
-  if(y0 == y2)
-  { // Handle awkward all-on-same-line case as its own thing
-    a = b = x0;
-    if(x1 < a)
-    {
-      a = x1;
-    }
-    else if(x1 > b)
-    {
-      b = x1;
-    }
-    if(x2 < a)
-    {
-      a = x2;
-    }
-    else if(x2 > b)
-    {
-      b = x2;
-    }
-    drawFastHLine(a, y0, b-a+1, color);
+void MicroGamerBase::fillTriangle
+(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
+ const uint8_t *pattern, uint8_t color)
+{
+  int16_t args[] = { x0, y0, x1, y1, x2, y2, color };
+  if (recordDrawCall(DL_FILL_TRIANGLE_PATTERN, min(min(y0, y1), y2),
+                     max(max(y0, y1), y2), args, 7, pattern))
     return;
-  }
 
-  int16_t dx01 = x1 - x0,
-      dy01 = y1 - y0,
-      dx02 = x2 - x0,
-      dy02 = y2 - y0,
-      dx12 = x2 - x1,
-      dy12 = y2 - y1,
-      sa = 0,
-      sb = 0;
-
-  // For upper part of triangle, find scanline crossings for segments
-  // 0-1 and 0-2.  If y1=y2 (flat-bottomed triangle), the scanline y1
-  // is included here (and second loop will be skipped, avoiding a /0
-  // error there), otherwise scanline y1 is skipped here and handled
-  // in the second loop...which also avoids a /0 error here if y0=y1
-  // (flat-topped triangle).
-  if (y1 == y2)
-  {
-    last = y1;   // Include y1 scanline
-  }
-  else
-  {
-    last = y1-1; // Skip it
-  }
+  Point points[] = { { x0, y0 }, { x1, y1 }, { x2, y2 } };
+  fillPattern = pattern;
+  fillConvexPolygon(points, 3, color);
+  fillPattern = NULL;
+}
 
+void MicroGamerBase::fillPolygon
+(const Point *points, uint8_t count, uint8_t color)
+{
+  int16_t top, bottom;
 
-  for(y = y0; y <= last; y++)
-  {
-    a   = x0 + sa / dy01;
-    b   = x0 + sb / dy02;
-    sa += dx01;
-    sb += dx02;
+  if (count == 0)
+    return;
+  pointsRows(points, count, &top, &bottom);
 
-    if(a > b)
-    {
-      swap(a,b);
-    }
+  int16_t args[] = { count, color };
+  if (recordDrawCall(DL_FILL_POLYGON, top, bottom, args, 2,
+                     (const uint8_t *)points))
+    return;
 
-    drawFastHLine(a, y, b-a+1, color);
-  }
+  fillConvexPolygon(points, count, color);
+}
 
-  // For lower part of triangle, find scanline crossings for segments
-  // 0-2 and 1-2.  This loop is skipped if y1=y2.
-  sa = dx12 * (y - y1);
-  sb = dx02 * (y - y0);
+// An edge of a filled polygon, giving its column on each row from its top
+// row down. The column is x0 + (dx * rows / dy), rounded towards x0 as the
+// old per row division did. It's found with one division for the edge,
+// after which the whole columns are added on each row and the remainder is
+// carried like in Bresenham's algorithm.
+struct PolygonEdge
+{
+  int16_t x;         // the column on the current row
+  int16_t step;      // the whole columns moved on each row
+  int16_t fraction;  // the remainder of dx / dy, without its sign
+  int16_t remainder; // the fractions added up so far
+  int16_t dy;
+  int8_t carry;      // the sign of dx
+};
 
-  for(; y <= y2; y++)
-  {
-    a   = x1 + sa / dy12;
-    b   = x0 + sb / dy02;
-    sa += dx12;
-    sb += dx02;
+// Start an edge on the row of its top end, (x0, y0), with y1 > y0
+static void edgeStart(PolygonEdge *edge, int16_t x0, int16_t y0,
+                      int16_t x1, int16_t y1)
+{
+  int16_t dx = x1 - x0;
 
-    if(a > b)
-    {
-      swap(a,b);
-    }
+  edge->x = x0;
+  edge->dy = y1 - y0;
+  edge->carry = (dx < 0) ? -1 : 1;
+  if (dx < 0)
+    dx = -dx;
+  edge->step = (dx / edge->dy) * edge->carry;
+  edge->fraction = dx % edge->dy;
+  edge->remainder = 0;
+}
+
+static inline void edgeStep(PolygonEdge *edge)
+{
+  edge->x += edge->step;
+  edge->remainder += edge->fraction;
+  if (edge->remainder >= edge->dy) {
+    edge->remainder -= edge->dy;
+    edge->x += edge->carry;
+  }
+}
+
+// One side of a convex polygon, the edges from its top to its bottom going
+// round the points in one direction
+struct PolygonSide
+{
+  PolygonEdge edge;
+  uint8_t from;      // the point at the top of the current edge
+  uint8_t to;        // the point at the bottom of the current edge
+  int8_t direction;  // 1 to go round the points forwards, -1 backwards
+};
+
+// Move a side on to the edge that covers row y, skipping flat edges. The
+// last edge ends at the bottom and covers the bottom row.
+static void sideFind(PolygonSide *side, const Point *points, uint8_t count,
+                     int16_t y, int16_t bottom)
+{
+  bool moved = false;
+
+  while (points[side->to].y <= y && points[side->to].y < bottom) {
+    side->from = side->to;
+    if (side->direction > 0)
+      side->to = (side->to == count - 1) ? 0 : side->to + 1;
+    else
+      side->to = (side->to == 0) ? count - 1 : side->to - 1;
+    moved = true;
+  }
+  if (moved) {
+    edgeStart(&side->edge, points[side->from].x, points[side->from].y,
+              points[side->to].x, points[side->to].y);
+  }
+}
+
+void MicroGamerBase::fillConvexPolygon(const Point *points, uint8_t count,
+                                       uint8_t color)
+{
+  uint8_t first = 0;
+  int16_t bottom = points[0].y;
+  int16_t left = points[0].x;
+  int16_t right = points[0].x;
+
+  for (uint8_t i = 1; i < count; i++) {
+    if (points[i].y < points[first].y)
+      first = i;
+    if (points[i].y > bottom)
+      bottom = points[i].y;
+    if (points[i].x < left)
+      left = points[i].x;
+    if (points[i].x > right)
+      right = points[i].x;
+  }
+
+  int16_t y = points[first].y;
+
+  // all the points on the same row
+  if (y == bottom) {
+    fillSpan(left, y, right, y, color);
+    return;
+  }
+
+  PolygonSide sides[2];
+
+  for (uint8_t i = 0; i < 2; i++) {
+    sides[i].from = first;
+    sides[i].to = first;
+    sides[i].direction = i ? -1 : 1;
+    sideFind(&sides[i], points, count, y, bottom);
+  }
+
+  // the rows below the clip rows don't need to be walked
+  int16_t last = bottom;
+  if (last > clipBottom - 1 - view.originY)
+    last = clipBottom - 1 - view.originY;
+
+  for (; y <= last; y++) {
+    for (uint8_t i = 0; i < 2; i++) {
+      if (points[sides[i].to].y <= y)
+        sideFind(&sides[i], points, count, y, bottom);
+    }
+
+    int16_t a = sides[0].edge.x;
+    int16_t b = sides[1].edge.x;
+
+    if (y >= clipTop - view.originY) {
+      if (a <= b)
+        fillSpan(a, y, b, y, color);
+      else
+        fillSpan(b, y, a, y, color);
+    }
+
+    edgeStep(&sides[0].edge);
+    edgeStep(&sides[1].edge);
+  }
+}
+
+/* Spans */
+
+// The rows of a quarter of an ellipse outline, from its top row to its
+// center row. A pixel at column x and row d from the center is inside when
+// ry2*x*x + rx2*d*d - max(ry2*x, rx2*d) < rx2*ry2, which for a circle is
+// the same pixels the midpoint algorithm draws. The outline of a row then
+// goes from the column after the outline of the row above, or the same
+// column if it's further out, to the last column inside.
+struct EllipseRows
+{
+  int32_t rx2;   // the radii squared
+  int32_t ry2;
+  int32_t error; // ry2*x*x + rx2*d*d - rx2*ry2 for the current x and d
+  int16_t x;     // the last column inside the current row so far
+  int16_t d;     // the current row, -1 when all have been returned
+  int16_t last;  // the last column inside the row above
+};
+
+static void ellipseRowsStart(EllipseRows *rows, uint8_t rx, uint8_t ry)
+{
+  rows->rx2 = rx * rx;
+  rows->ry2 = ry * ry;
+  rows->error = 0;
+  rows->x = 0;
+  rows->d = ry;
+  rows->last = -1;
+}
+
+// Get the row and the columns of the outline in it, or return false if
+// there are no more rows. The errors stay small enough for 32 bits, as they
+// are never far from the outline.
+static bool ellipseRowsNext(EllipseRows *rows, int16_t *d,
+                            int16_t *inner, int16_t *outer)
+{
+  if (rows->d < 0)
+    return false;
+
+  int32_t edge = rows->rx2 * rows->d;
+
+  for (;;) {
+    int32_t error = rows->error + (rows->ry2 * ((2 * rows->x) + 1));
+    int32_t step = rows->ry2 * (rows->x + 1);
+
+    if (error - (step > edge ? step : edge) >= 0)
+      break;
+    rows->error = error;
+    rows->x++;
+  }
+
+  *d = rows->d;
+  *outer = rows->x;
+  *inner = (rows->last + 1 < rows->x) ? rows->last + 1 : rows->x;
+
+  rows->last = rows->x;
+  rows->error -= rows->rx2 * ((2 * rows->d) - 1);
+  rows->d--;
+  return true;
+}
+
+// Combine a byte or word of the display buffer with a mask of its pixels
+template<uint8_t Color, typename T>
+static inline T spanBlend(T value, T mask)
+{
+  if (Color == WHITE)
+    return value | mask;
+  if (Color == BLACK)
+    return value & ~mask;
+  return value ^ mask;
+}
+
+// Combine count bytes of a page with the same mask, 4 at a time once the
+// destination is aligned
+template<uint8_t Color>
+static void spanFill(uint8_t *dst, uint8_t count, uint8_t mask)
+{
+  uint32_t wordMask = mask * 0x01010101UL;
+  uint32_t word;
+
+  for (; count > 0 && ((uintptr_t)dst & 3); count--, dst++)
+    *dst = spanBlend<Color, uint8_t>(*dst, mask);
+
+  for (; count >= 4; count -= 4, dst += 4) {
+    memcpy(&word, __builtin_assume_aligned(dst, 4), 4);
+    word = spanBlend<Color, uint32_t>(word, wordMask);
+    memcpy(__builtin_assume_aligned(dst, 4), &word, 4);
+  }
+
+  for (; count > 0; count--, dst++)
+    *dst = spanBlend<Color, uint8_t>(*dst, mask);
+}
+
+// Combine count bytes of a page, from column x, with a mask and an 8 column
+// pattern. Once the destination is aligned, the pattern repeats every 2
+// words, which are worked out once.
+template<uint8_t Color>
+static void spanPattern(uint8_t *dst, uint8_t count, uint8_t x, uint8_t mask,
+                        const uint8_t *pattern)
+{
+  uint8_t bytes[8];
+  uint32_t words[2];
+  uint32_t word;
+
+  for (; count > 0 && ((uintptr_t)dst & 3); count--, dst++, x++) {
+    uint8_t bits = mask & pgm_read_byte(pattern + (x & 7));
+    *dst = spanBlend<Color, uint8_t>(*dst, bits);
+  }
+
+  for (uint8_t i = 0; i < 8; i++)
+    bytes[i] = mask & pgm_read_byte(pattern + ((x + i) & 7));
+  memcpy(words, bytes, sizeof(words));
+
+  uint8_t i = 0;
+  for (; count >= 4; count -= 4, dst += 4, i += 4) {
+    memcpy(&word, __builtin_assume_aligned(dst, 4), 4);
+    word = spanBlend<Color, uint32_t>(word, words[(i >> 2) & 1]);
+    memcpy(__builtin_assume_aligned(dst, 4), &word, 4);
+  }
+
+  for (; count > 0; count--, dst++, i++)
+    *dst = spanBlend<Color, uint8_t>(*dst, bytes[i & 7]);
+}
+
+void MicroGamerBase::fillTargetSpan(int16_t x0, int16_t y0,
+                                    int16_t x1, int16_t y1, uint8_t color)
+{
+  if (x0 < clipLeft)
+    x0 = clipLeft;
+  if (x1 > clipRight - 1)
+    x1 = clipRight - 1;
+  if (y0 < clipTop)
+    y0 = clipTop;
+  if (y1 > clipBottom - 1)
+    y1 = clipBottom - 1;
+  if (x1 < x0 || y1 < y0 || color > INVERSE)
+    return;
+
+  uint8_t firstPage = y0 / 8;
+  uint8_t lastPage = y1 / 8;
+  uint8_t count = x1 - x0 + 1;
+  int16_t width = targetWidth;
+  uint8_t *row = sBuffer + (firstPage * width) + x0;
+
+  for (uint8_t page = firstPage; page <= lastPage; page++, row += width) {
+    // only the top and bottom pages can be partly covered
+    uint8_t mask = 0xFF;
+    if (page == firstPage)
+      mask <<= (y0 & 7);
+    if (page == lastPage)
+      mask &= 0xFF >> (7 - (y1 & 7));
+
+    if (fillPattern != NULL) {
+      if (color == WHITE)
+        spanPattern<WHITE>(row, count, x0, mask, fillPattern);
+      else if (color == BLACK)
+        spanPattern<BLACK>(row, count, x0, mask, fillPattern);
+      else
+        spanPattern<INVERSE>(row, count, x0, mask, fillPattern);
+    }
+    else if (mask == 0xFF && color != INVERSE)
+      memset(row, color == WHITE ? 0xFF : 0x00, count);
+    else if (color == WHITE)
+      spanFill<WHITE>(row, count, mask);
+    else if (color == BLACK)
+      spanFill<BLACK>(row, count, mask);
+    else
+      spanFill<INVERSE>(row, count, mask);
+
+    markDrawn(page, x0, x1);
+  }
+}
+
+void MicroGamerBase::drawOutlineSpan(int16_t x0, int16_t y0,
+                                     int16_t x1, int16_t y1,
+                                     uint8_t color, const ArcWedge *arc)
+{
+  if (arc == NULL) {
+    fillSpan(x0, y0, x1, y1, color);
+    return;
+  }
+
+  // Draw the runs of pixels in the arc. A pixel is between the ends when
+  // it's clockwise of the start and anticlockwise of the end, or, for a
+  // major arc, when it isn't between them the other way around.
+  bool row = (y0 == y1);
+  int16_t length = row ? x1 - x0 : y1 - y0;
+  int16_t start = -1;
+
+  for (int16_t i = 0; i <= length + 1; i++) {
+    bool in = false;
+
+    if (i <= length) {
+      int16_t dx = (row ? x0 + i : x0) - arc->x0;
+      int16_t dy = (row ? y0 : y0 + i) - arc->y0;
+      int32_t fromStart = ((int32_t)arc->startX * dy) -
+                          ((int32_t)arc->startY * dx);
+      int32_t toEnd = ((int32_t)dx * arc->endY) - ((int32_t)dy * arc->endX);
+
+      if (arc->major)
+        in = !(fromStart < 0 && toEnd < 0);
+      else
+        in = (fromStart >= 0 && toEnd >= 0);
+    }
+
+    if (in && start < 0) {
+      start = i;
+    }
+    else if (!in && start >= 0) {
+      if (row)
+        fillSpan(x0 + start, y0, x0 + i - 1, y0, color);
+      else
+        fillSpan(x0, y0 + start, x0, y0 + i - 1, color);
+      start = -1;
+    }
+  }
+}
+
+void MicroGamerBase::drawEllipseCorners
+(int16_t xl, int16_t yt, int16_t xr, int16_t yb, uint8_t rx, uint8_t ry,
+ uint8_t corners, bool whole, uint8_t color, const ArcWedge *arc)
+{
+  EllipseRows rows;
+  int16_t d, inner, outer;
+  // without the whole outline, the axes are left out
+  int16_t axis = whole ? 0 : 1;
+
+  // The flat part of each corner, above its diagonal, is drawn as rows. A
+  // row starting on the axis goes across, along the edge between corners.
+  ellipseRowsStart(&rows, rx, ry);
+  while (ellipseRowsNext(&rows, &d, &inner, &outer)) {
+    if (inner < axis)
+      inner = axis;
+    if (inner > d)
+      break;
+    if (outer > d)
+      outer = d;
+    if (outer < inner)
+      continue;
+
+    int16_t top = yt - d;
+    int16_t bottom = yb + d;
+
+    if (inner == 0) {
+      drawOutlineSpan(xl - outer, top, xr + outer, top, color, arc);
+      if (bottom != top)
+        drawOutlineSpan(xl - outer, bottom, xr + outer, bottom, color, arc);
+      continue;
+    }
+
+    if (corners & 0x1)
+      drawOutlineSpan(xl - outer, top, xl - inner, top, color, arc);
+    if (corners & 0x2)
+      drawOutlineSpan(xr + inner, top, xr + outer, top, color, arc);
+    if (corners & 0x4)
+      drawOutlineSpan(xr + inner, bottom, xr + outer, bottom, color, arc);
+    if (corners & 0x8)
+      drawOutlineSpan(xl - outer, bottom, xl - inner, bottom, color, arc);
+  }
+
+  // The steep part, below the diagonal, is drawn as columns, which are the
+  // rows of the ellipse turned on its side.
+  ellipseRowsStart(&rows, ry, rx);
+  while (ellipseRowsNext(&rows, &d, &inner, &outer)) {
+    if (inner < axis)
+      inner = axis;
+    if (inner > d - 1)
+      break;
+    if (outer > d - 1)
+      outer = d - 1;
+    if (outer < inner)
+      continue;
+
+    int16_t left = xl - d;
+    int16_t right = xr + d;
+
+    if (inner == 0) {
+      drawOutlineSpan(left, yt - outer, left, yb + outer, color, arc);
+      drawOutlineSpan(right, yt - outer, right, yb + outer, color, arc);
+      continue;
+    }
+
+    if (corners & 0x1)
+      drawOutlineSpan(left, yt - outer, left, yt - inner, color, arc);
+    if (corners & 0x2)
+      drawOutlineSpan(right, yt - outer, right, yt - inner, color, arc);
+    if (corners & 0x4)
+      drawOutlineSpan(right, yb + inner, right, yb + outer, color, arc);
+    if (corners & 0x8)
+      drawOutlineSpan(left, yb + inner, left, yb + outer, color, arc);
+  }
+
+  // with no width, the side edges are on the axes
+  if (whole && rx == 0 && yb > yt + 1) {
+    drawOutlineSpan(xl, yt + 1, xl, yb - 1, color, arc);
+    if (xr != xl)
+      drawOutlineSpan(xr, yt + 1, xr, yb - 1, color, arc);
+  }
+}
+
+void MicroGamerBase::fillEllipseSides
+(int16_t xl, int16_t yt, int16_t xr, int16_t yb, uint8_t rx, uint8_t ry,
+ uint8_t sides, uint8_t color)
+{
+  EllipseRows columns;
+  int16_t c, inner, outer;
+
+  // the columns are the rows of the ellipse turned on its side
+  ellipseRowsStart(&columns, ry, rx);
+  while (ellipseRowsNext(&columns, &c, &inner, &outer) && c > 0) {
+    if (sides & 0x1) // right side
+      fillSpan(xr + c, yt - outer, xr + c, yb + outer, color);
+    if (sides & 0x2) // left side
+      fillSpan(xl - c, yt - outer, xl - c, yb + outer, color);
+  }
+}
+
+/* Bitmap blitting */
+
+// Read 4 bytes of a bitmap as a word, the first byte in the low bits
+static inline uint32_t blitLoadWord(const uint8_t *src, bool aligned)
+{
+  uint32_t word;
+
+  if (aligned) {
+    memcpy(&word, __builtin_assume_aligned(src, 4), 4);
+  }
+  else {
+    word = pgm_read_byte(src) |
+           (pgm_read_byte(src + 1) << 8) |
+           (pgm_read_byte(src + 2) << 16) |
+           ((uint32_t)pgm_read_byte(src + 3) << 24);
+  }
+  return word;
+}
+
+// Combine bits with an aligned word of the display buffer. The bits, and
+// those of cover, are cleared with clearMask and the bits are flipped with
+// flipMask, which are either 0 or all ones depending on the color.
+static inline void blitStoreWord(uint8_t *dst, uint32_t bits, uint32_t cover,
+                                 uint32_t clearMask, uint32_t flipMask)
+{
+  uint32_t word;
+
+  memcpy(&word, __builtin_assume_aligned(dst, 4), 4);
+  word = (word & ~((bits | cover) & clearMask)) ^ (bits & flipMask);
+  memcpy(__builtin_assume_aligned(dst, 4), &word, 4);
+}
+
+// Draw count bytes of a page row of a bitmap, moved down by yOffset rows,
+// on the display buffer page at top and the one below it at bottom. Either
+// page is NULL if it's clipped, and bottom is also NULL if yOffset is 0.
+// Only the rows set in topClip and bottomClip are changed on each page.
+// The bytes are combined 4 at a time once the destination is aligned,
+// shifting each byte of the word separately.
+static void blitPageRow(uint8_t *top, uint8_t *bottom, const uint8_t *src,
+                        int16_t count, uint8_t yOffset, uint8_t color,
+                        uint8_t topClip, uint8_t bottomClip)
+{
+  // WHITE sets the bits, BLACK clears them and INVERT flips them.
+  // BLIT_COPY clears all the bits the row covers, then sets them.
+  uint32_t clearMask = (color == INVERT) ? 0 : 0xFFFFFFFF;
+  uint32_t flipMask = (color == BLACK) ? 0 : 0xFFFFFFFF;
+  uint32_t topMask = 0x01010101 * (uint8_t)((0xFF << yOffset) & topClip);
+  uint32_t bottomMask = 0x01010101 *
+                        (uint8_t)((0xFF >> (8 - yOffset)) & bottomClip);
+  uint32_t topCover = (color == BLIT_COPY) ? topMask : 0;
+  uint32_t bottomCover = (color == BLIT_COPY) ? bottomMask : 0;
+  uintptr_t column = (uintptr_t)(top != NULL ? top : bottom);
+  bool aligned;
+
+  // single bytes up to the first aligned word
+  while (count > 0 && (column & 3) != 0) {
+    uint8_t data = pgm_read_byte(src++);
+
+    if (top != NULL) {
+      uint8_t bits = (data << yOffset) & topMask;
+      *top = (*top & ~((bits | topCover) & clearMask)) ^ (bits & flipMask);
+      top++;
+    }
+    if (bottom != NULL) {
+      uint8_t bits = (data >> (8 - yOffset)) & bottomMask;
+      *bottom = (*bottom & ~((bits | bottomCover) & clearMask)) ^
+                (bits & flipMask);
+      bottom++;
+    }
+    column++;
+    count--;
+  }
+
+  aligned = ((uintptr_t)src & 3) == 0;
+  if (yOffset == 0) {
+    // the rows line up with the pages, the bytes are used as they are
+    while (count >= 4) {
+      blitStoreWord(top, blitLoadWord(src, aligned) & topMask, topCover,
+                    clearMask, flipMask);
+      top += 4;
+      src += 4;
+      count -= 4;
+    }
+  }
+  else {
+    while (count >= 4) {
+      uint32_t word = blitLoadWord(src, aligned);
+
+      if (top != NULL) {
+        blitStoreWord(top, (word << yOffset) & topMask, topCover,
+                      clearMask, flipMask);
+        top += 4;
+      }
+      if (bottom != NULL) {
+        blitStoreWord(bottom, (word >> (8 - yOffset)) & bottomMask,
+                      bottomCover, clearMask, flipMask);
+        bottom += 4;
+      }
+      src += 4;
+      count -= 4;
+    }
+  }
+
+  // the bytes left after the last whole word
+  while (count > 0) {
+    uint8_t data = pgm_read_byte(src++);
+
+    if (top != NULL) {
+      uint8_t bits = (data << yOffset) & topMask;
+      *top = (*top & ~((bits | topCover) & clearMask)) ^ (bits & flipMask);
+      top++;
+    }
+    if (bottom != NULL) {
+      uint8_t bits = (data >> (8 - yOffset)) & bottomMask;
+      *bottom = (*bottom & ~((bits | bottomCover) & clearMask)) ^
+                (bits & flipMask);
+      bottom++;
+    }
+    count--;
+  }
+}
+
+// The clipped area of a bitmap drawn at x, y, worked out once for all its
+// page rows
+struct BlitArea
+{
+  int16_t firstColumn; // first visible column of the bitmap
+  int16_t count;       // number of visible columns
+  int16_t firstRow;    // first page row of the bitmap to draw
+  int16_t lastRow;     // last page row of the bitmap to draw, plus one
+  int16_t page;        // display page of the bitmap's first page row
+  uint8_t yOffset;     // rows the bitmap is moved down within the page
+  int16_t width;       // width of the buffer drawn on
+  int16_t firstPage;   // first page that can be drawn on
+  int16_t lastPage;    // last page that can be drawn on
+  uint8_t firstRows;   // rows of the first page that can be drawn on
+  uint8_t lastRows;    // rows of the last page that can be drawn on
+};
+
+// Clip a bitmap of w columns and rows page rows, at x, y in target
+// coordinates, to a buffer width and the clip area from column left to
+// right - 1 and row top to bottom - 1. Returns false if nothing is visible.
+static bool blitClip(BlitArea *area, int16_t x, int16_t y, int16_t w,
+                     int16_t rows, int16_t left, int16_t top, int16_t right,
+                     int16_t bottom, int16_t width)
+{
+  if (top >= bottom)
+    return false;
+
+  area->yOffset = y & 7;
+  area->page = (y - area->yOffset) / 8;
+  area->width = width;
+  area->firstPage = top / 8;
+  area->lastPage = (bottom - 1) / 8;
+  area->firstRows = 0xFF << (top & 7);
+  area->lastRows = 0xFF >> (7 - ((bottom - 1) & 7));
+  area->firstColumn = (x < left) ? left - x : 0;
+  area->count = min(x + w, right) - x - area->firstColumn;
+  // a page row also draws on the page below it when it's moved down
+  area->firstRow = max(area->firstPage - area->page -
+                       (area->yOffset ? 1 : 0), 0);
+  area->lastRow = min(area->lastPage - area->page + 1, rows);
+
+  return area->count > 0 && area->firstRow < area->lastRow;
+}
+
+// The rows of a page of the buffer that a clipped bitmap can draw on
+static inline uint8_t blitPageRows(const BlitArea *area, int16_t page)
+{
+  uint8_t rows = 0xFF;
+
+  if (page == area->firstPage)
+    rows &= area->firstRows;
+  if (page == area->lastPage)
+    rows &= area->lastRows;
+  return rows;
+}
+
+// Draw one page row of a clipped bitmap at x in target coordinates, src
+// being its first visible byte
+static void blitClippedRow(const BlitArea *area, int16_t row,
+                           const uint8_t *src, int16_t x, uint8_t color)
+{
+  int16_t page = area->page + row;
+  uint8_t *column = MicroGamerBase::sBuffer + x + area->firstColumn;
+  uint8_t *top = NULL;
+  uint8_t *bottom = NULL;
+
+  if (page >= area->firstPage)
+    top = column + (page * area->width);
+  if (area->yOffset != 0 && page < area->lastPage)
+    bottom = column + ((page + 1) * area->width);
+  blitPageRow(top, bottom, src, area->count, area->yOffset, color,
+              blitPageRows(area, page), blitPageRows(area, page + 1));
+}
+
+void MicroGamerBase::drawBitmap
+(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t w, uint8_t h,
+ uint8_t color)
+{
+  // the bitmap is clipped and drawn in target coordinates
+  int16_t left = x + view.originX;
+  int16_t top = y + view.originY;
+
+  // no need to draw at all if we're outside of the clip rectangle
+  if (left + w < clipLeft || left > clipRight - 1 ||
+      top + h < clipRectTop() || top > clipRectBottom() - 1)
+    return;
+
+  int rows = h/8;
+  if (h%8!=0) rows++;
+
+  int16_t args[] = { x, y, w, h, color };
+  if (recordDrawCall(DL_DRAW_BITMAP, y, y + (rows * 8) - 1, args, 5, bitmap))
+    return;
+
+  BlitArea area;
+
+  markDirty(left, top, w, rows * 8);
+  if (!blitClip(&area, left, top, w, rows, clipLeft, clipTop, clipRight,
+                clipBottom, targetWidth))
+    return;
+
+  if (color != WHITE && color != BLACK)
+    color = INVERT;
+  for (int16_t row = area.firstRow; row < area.lastRow; row++) {
+    blitClippedRow(&area, row, bitmap + (row * w) + area.firstColumn,
+                   left, color);
+  }
+}
+
+void MicroGamerBase::drawSurface
+(int16_t x, int16_t y, const Surface *surface, uint8_t mode)
+{
+  int16_t w = surface->width;
+  int16_t rows = surface->pages;
+
+  int16_t left = x + view.originX;
+  int16_t top = y + view.originY;
+
+  if (left + w < clipLeft || left > clipRight - 1 ||
+      top + (rows * 8) < clipRectTop() || top > clipRectBottom() - 1)
+    return;
+
+  int16_t args[] = { x, y, mode };
+  if (recordDrawCall(DL_DRAW_SURFACE, y, y + (rows * 8) - 1, args, 3,
+                     (const uint8_t *)surface))
+    return;
+
+  BlitArea area;
+
+  markDirty(left, top, w, rows * 8);
+  if (!blitClip(&area, left, top, w, rows, clipLeft, clipTop, clipRight,
+                clipBottom, targetWidth))
+    return;
+
+  if (mode > BLIT_COPY)
+    mode = BLIT_COPY;
+  for (int16_t row = area.firstRow; row < area.lastRow; row++) {
+    blitClippedRow(&area, row,
+                   surface->buffer + (row * w) + area.firstColumn,
+                   left, mode);
+  }
+}
+
+// Divide a map coordinate by a tile size, rounding down, with the
+// remainder from 0 to size - 1
+static int16_t tileDivide(int16_t value, uint8_t size, int16_t *remainder)
+{
+  int16_t quotient = value / size;
+
+  *remainder = value - (quotient * size);
+  if (*remainder < 0) {
+    quotient--;
+    *remainder += size;
+  }
+  return quotient;
+}
+
+// Find the bytes of a page row of the tile at a column and row of a map,
+// or return NULL if they're outside it
+static const uint8_t *tileRow(const Tilemap *tilemap, int16_t column,
+                              int16_t row, uint8_t page, uint16_t tileBytes,
+                              uint8_t frame)
+{
+  if (column < 0 || column >= tilemap->width ||
+      row < 0 || row >= tilemap->height)
+    return NULL;
+
+  uint8_t tile = pgm_read_byte(tilemap->map + (row * tilemap->width) + column);
+
+  if (tilemap->frames != NULL) {
+    uint8_t frames = pgm_read_byte(tilemap->frames + tile);
+    if (frames > 1)
+      tile += frame % frames;
+  }
+  return tilemap->tileset + 2 + (tile * tileBytes) +
+         (page * pgm_read_byte(tilemap->tileset));
+}
+
+void MicroGamerBase::drawTilemap
+(const Tilemap *tilemap, int16_t cameraX, int16_t cameraY, uint8_t frame)
+{
+  int16_t args[] = { cameraX, cameraY, frame };
+  if (recordDrawCall(DL_DRAW_TILEMAP, clipTop - view.originY,
+                     clipBottom - 1 - view.originY, args, 3,
+                     (const uint8_t *)tilemap))
+    return;
+
+  uint8_t tileWidth = pgm_read_byte(tilemap->tileset);
+  uint8_t tilePages = (pgm_read_byte(tilemap->tileset + 1) + 7) / 8;
+  uint16_t tileBytes = tileWidth * tilePages;
+
+  if (tileWidth == 0 || tilePages == 0 || clipBottom <= clipTop)
+    return;
+
+  // the map is drawn over the clip area, in target coordinates
+  cameraX -= view.originX;
+  cameraY -= view.originY;
+
+  int16_t firstPage = clipTop / 8;
+  int16_t lastPage = (clipBottom - 1) / 8;
+  uint8_t shift = cameraY & 7;
+  int16_t width = targetWidth;
+
+  // the map column of the left edge, and the column within its tiles
+  int16_t within;
+  int16_t firstColumn = tileDivide(cameraX + clipLeft, tileWidth, &within);
+
+  // the page row of the map at the top of the first page drawn, as a row
+  // of tiles and a page within them
+  int16_t page;
+  int16_t row = tileDivide(((cameraY - shift) / 8) + firstPage, tilePages,
+                           &page);
+
+  markDirty(clipLeft, firstPage * 8, clipRight - clipLeft,
+            (lastPage - firstPage + 1) * 8);
+
+  for (int16_t p = firstPage; p <= lastPage; p++) {
+    uint8_t *dst = sBuffer + (p * width);
+    // the page row below, merged in when the map is moved up by shift rows
+    int16_t nextRow = (page + 1 < tilePages) ? row : row + 1;
+    uint8_t nextPage = (page + 1 < tilePages) ? page + 1 : 0;
+
+    // the rows of the page that can be drawn on
+    uint8_t mask = 0xFF;
+    if (p == firstPage)
+      mask &= 0xFF << (clipTop & 7);
+    if (p == lastPage)
+      mask &= 0xFF >> (7 - ((clipBottom - 1) & 7));
+
+    int16_t column = firstColumn;
+    int16_t start = within;
+
+    for (int16_t x = clipLeft; x < clipRight; column++, start = 0) {
+      int16_t count = tileWidth - start;
+      if (count > clipRight - x)
+        count = clipRight - x;
+
+      const uint8_t *upper = tileRow(tilemap, column, row, page,
+                                     tileBytes, frame);
+      const uint8_t *lower = (shift == 0) ? NULL :
+                             tileRow(tilemap, column, nextRow, nextPage,
+                                     tileBytes, frame);
+
+      if (shift == 0 && mask == 0xFF) {
+        // the tile rows line up with the page, copy them as they are
+        if (upper != NULL)
+          memcpy(dst + x, upper + start, count);
+        else
+          memset(dst + x, 0, count);
+      }
+      else if (upper != NULL && lower != NULL && mask == 0xFF) {
+        // the bytes of the two tile rows over the page, shifted and merged
+        upper += start;
+        lower += start;
+        for (int16_t i = 0; i < count; i++) {
+          dst[x + i] = (pgm_read_byte(upper + i) >> shift) |
+                       (pgm_read_byte(lower + i) << (8 - shift));
+        }
+      }
+      else {
+        for (int16_t i = 0; i < count; i++) {
+          uint8_t bits = 0;
+          if (upper != NULL)
+            bits = pgm_read_byte(upper + start + i) >> shift;
+          if (lower != NULL)
+            bits |= pgm_read_byte(lower + start + i) << (8 - shift);
+          dst[x + i] = (dst[x + i] & ~mask) | (bits & mask);
+        }
+      }
+      x += count;
+    }
+
+    row = nextRow;
+    page = nextPage;
+  }
+}
+
+void MicroGamerBase::drawSlowXYBitmap
+(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t w, uint8_t h, uint8_t color)
+{
+  // no need to draw at all if we're outside of the clip rectangle
+  if (clippedOut(x, y, w, h))
+    return;
+
+  int16_t args[] = { x, y, w, h, color };
+  if (recordDrawCall(DL_DRAW_SLOW_XY_BITMAP, y, y + h - 1, args, 5, bitmap))
+    return;
+
+  int16_t xi, yi, byteWidth = (w + 7) / 8;
+  for(yi = 0; yi < h; yi++) {
+    for(xi = 0; xi < w; xi++ ) {
+      if(pgm_read_byte(bitmap + yi * byteWidth + xi / 8) & (128 >> (xi & 7))) {
+        drawPixel(x + xi, y + yi, color);
+      }
+    }
+  }
+}
+
+/* Compressed bitmaps */
+
+// Reads the bits of a compressed bitmap, least significant bit of each byte
+// first. The state is kept by the caller, so drawCompressed() is reentrant.
+struct CompressedReader
+{
+  const uint8_t *src; // next byte to load
+  uint32_t bits;      // loaded bits not read yet, the next one in bit 0
+  uint8_t count;      // number of loaded bits
+};
+
+// A span length is coded as k zero bits and a one bit, followed by 2k + 1
+// bits of the length minus one. This table decodes the codes that fit in the
+// next 8 bits, with k + 1 in bits 5 to 6 and the length minus one in bits 0
+// to 4. Zero means the code is longer.
+static const uint8_t compressedSpans[256] PROGMEM = {
+  0x00, 0x20, 0x40, 0x21, 0x60, 0x20, 0x41, 0x21,
+  0x00, 0x20, 0x42, 0x21, 0x61, 0x20, 0x43, 0x21,
+  0x00, 0x20, 0x44, 0x21, 0x62, 0x20, 0x45, 0x21,
+  0x00, 0x20, 0x46, 0x21, 0x63, 0x20, 0x47, 0x21,
+  0x00, 0x20, 0x40, 0x21, 0x64, 0x20, 0x41, 0x21,
+  0x00, 0x20, 0x42, 0x21, 0x65, 0x20, 0x43, 0x21,
+  0x00, 0x20, 0x44, 0x21, 0x66, 0x20, 0x45, 0x21,
+  0x00, 0x20, 0x46, 0x21, 0x67, 0x20, 0x47, 0x21,
+  0x00, 0x20, 0x40, 0x21, 0x68, 0x20, 0x41, 0x21,
+  0x00, 0x20, 0x42, 0x21, 0x69, 0x20, 0x43, 0x21,
+  0x00, 0x20, 0x44, 0x21, 0x6A, 0x20, 0x45, 0x21,
+  0x00, 0x20, 0x46, 0x21, 0x6B, 0x20, 0x47, 0x21,
+  0x00, 0x20, 0x40, 0x21, 0x6C, 0x20, 0x41, 0x21,
+  0x00, 0x20, 0x42, 0x21, 0x6D, 0x20, 0x43, 0x21,
+  0x00, 0x20, 0x44, 0x21, 0x6E, 0x20, 0x45, 0x21,
+  0x00, 0x20, 0x46, 0x21, 0x6F, 0x20, 0x47, 0x21,
+  0x00, 0x20, 0x40, 0x21, 0x70, 0x20, 0x41, 0x21,
+  0x00, 0x20, 0x42, 0x21, 0x71, 0x20, 0x43, 0x21,
+  0x00, 0x20, 0x44, 0x21, 0x72, 0x20, 0x45, 0x21,
+  0x00, 0x20, 0x46, 0x21, 0x73, 0x20, 0x47, 0x21,
+  0x00, 0x20, 0x40, 0x21, 0x74, 0x20, 0x41, 0x21,
+  0x00, 0x20, 0x42, 0x21, 0x75, 0x20, 0x43, 0x21,
+  0x00, 0x20, 0x44, 0x21, 0x76, 0x20, 0x45, 0x21,
+  0x00, 0x20, 0x46, 0x21, 0x77, 0x20, 0x47, 0x21,
+  0x00, 0x20, 0x40, 0x21, 0x78, 0x20, 0x41, 0x21,
+  0x00, 0x20, 0x42, 0x21, 0x79, 0x20, 0x43, 0x21,
+  0x00, 0x20, 0x44, 0x21, 0x7A, 0x20, 0x45, 0x21,
+  0x00, 0x20, 0x46, 0x21, 0x7B, 0x20, 0x47, 0x21,
+  0x00, 0x20, 0x40, 0x21, 0x7C, 0x20, 0x41, 0x21,
+  0x00, 0x20, 0x42, 0x21, 0x7D, 0x20, 0x43, 0x21,
+  0x00, 0x20, 0x44, 0x21, 0x7E, 0x20, 0x45, 0x21,
+  0x00, 0x20, 0x46, 0x21, 0x7F, 0x20, 0x47, 0x21,
+};
+
+// Load the next byte. Bytes are only loaded when a bit of them is read, so
+// nothing past the end of the bitmap is read.
+static inline void compressedLoad(CompressedReader *reader)
+{
+  reader->bits |= (uint32_t)pgm_read_byte(reader->src) << reader->count;
+  reader->src++;
+  reader->count += 8;
+}
+
+// Read a value of up to 24 bits
+static uint32_t compressedRead(CompressedReader *reader, uint8_t bits)
+{
+  uint32_t value;
+
+  while (reader->count < bits)
+    compressedLoad(reader);
+  value = reader->bits & ((1UL << bits) - 1);
+  reader->bits >>= bits;
+  reader->count -= bits;
+  return value;
+}
+
+// Read the length of a span
+static uint32_t compressedSpan(CompressedReader *reader)
+{
+  uint8_t entry;
+  uint8_t bits = 1;
+
+  // the bits not loaded yet are read as zeros, so a code that has all its
+  // bits loaded is decoded correctly, and another byte is only loaded when
+  // the code is longer
+  for (;;) {
+    entry = pgm_read_byte(compressedSpans + (reader->bits & 0xFF));
+    bits = entry != 0 ? ((entry >> 5) * 3) - 1 : 9;
+    if (bits <= reader->count || reader->count >= 8)
+      break;
+    compressedLoad(reader);
+  }
+  if (entry != 0) {
+    reader->bits >>= bits;
+    reader->count -= bits;
+    return (entry & 0x1F) + 1;
+  }
+
+  // a span longer than 32 pixels, the lengths of a 256x256 bitmap fit in
+  // 17 bits, which is 8 zero bits before the one bit
+  bits = 1;
+  while (!compressedRead(reader, 1) && bits < 17)
+    bits += 2;
+  return compressedRead(reader, bits) + 1;
+}
+
+// Move the reader past a compressed bitmap, to the byte following it
+static void compressedSkip(CompressedReader *reader)
+{
+  uint16_t w = compressedRead(reader, 8) + 1;
+  uint16_t h = compressedRead(reader, 8) + 1;
+  uint32_t left = (uint32_t)w * ((h + 7) & ~7);
+
+  compressedRead(reader, 1); // starting colour
+  while (left > 0) {
+    uint32_t len = compressedSpan(reader);
+    left -= min(len, left);
+  }
+
+  // the loaded bytes not read from at all
+  reader->src -= reader->count / 8;
+  reader->bits = 0;
+  reader->count = 0;
+}
+
+// Set the bits from first to last - 1 of a page row, bit n * 8 being the top
+// pixel of column n
+static void compressedSetBits(uint8_t *row, uint16_t first, uint16_t last)
+{
+  uint8_t *byte = row + (first / 8);
+  uint8_t *end = row + (last / 8);
+  uint8_t firstMask = 0xFF << (first & 7);
+  uint8_t lastMask = ~(0xFF << (last & 7));
+
+  if (byte == end) {
+    *byte |= firstMask & lastMask;
+    return;
+  }
+  *byte++ |= firstMask;
+  while (byte < end)
+    *byte++ = 0xFF;
+  if (lastMask != 0)
+    *end |= lastMask;
+}
+
+#if MICROGAMER_SPRITE_CACHE_SIZE
+// Decode the spans of a compressed bitmap, starting with colour col, into an
+// image of length pixels in the Sprites format
+static void compressedDecode(CompressedReader *reader, uint8_t col,
+                             uint8_t *image, uint16_t length)
+{
+  uint16_t pos = 0;
+
+  memset(image, 0, length / 8);
+  while (pos < length) {
+    uint32_t len = compressedSpan(reader);
+    uint16_t n = min(len, (uint32_t)(length - pos));
+
+    if (col)
+      compressedSetBits(image, pos, pos + n);
+    pos += n;
+    col = 1 - col;
+  }
+}
+#endif
+
+void MicroGamerBase::drawCompressed(int16_t sx, int16_t sy, const uint8_t *bitmap, uint8_t color, uint8_t frame)
+{
+  CompressedReader reader = { bitmap, 0, 0 };
+  const uint8_t *start;
+  int16_t w, h;
+  uint8_t col = 0;
+
+#if MICROGAMER_SPRITE_CACHE_SIZE
+  SpriteCacheEntry *cached = spriteCacheFind(bitmap, frame);
+
+  if (cached != NULL) {
+    start = cached->start;
+    w = cached->width;
+    h = cached->height;
+  }
+  else
+#endif
+  {
+    // the frames are complete bitmaps one after the other
+    for (uint8_t i = 0; i < frame; i++)
+      compressedSkip(&reader);
+    start = reader.src;
+
+    // read header
+
+    w = compressedRead(&reader, 8) + 1;
+    h = compressedRead(&reader, 8) + 1;
+
+    col = compressedRead(&reader, 1); // starting colour
+  }
+
+  // the bitmap is clipped and drawn in target coordinates
+  int16_t left = sx + view.originX;
+  int16_t top = sy + view.originY;
+
+  // no need to draw at all if we're outside of the clip rectangle
+  if (left + w < clipLeft || left > clipRight - 1 ||
+      top + h < clipRectTop() || top > clipRectBottom() - 1)
+    return;
+
+  // recorded with the frame's own data, so it's replayed as frame 0
+  int16_t args[] = { sx, sy, color };
+  if (recordDrawCall(DL_DRAW_COMPRESSED, sy, sy + ((h + 7) & ~7) - 1,
+                     args, 3, start))
+    return;
+
+  int rows = h / 8;
+  if (h % 8 != 0) rows++;
+
+#if MICROGAMER_SPRITE_CACHE_SIZE
+  if (cached != NULL) {
+    spriteCacheHitCount++;
+  }
+  else {
+    spriteCacheMissCount++;
+    if (w < 256 && rows * 8 < 256 && w * rows <= MICROGAMER_SPRITE_CACHE_SIZE) {
+      cached = spriteCacheAdd(bitmap, frame, start, w, h, w * rows);
+      compressedDecode(&reader, col, spriteCache + cached->offset,
+                       w * rows * 8);
+    }
+  }
+
+  // the decoded image is drawn as a sprite, whole pages like below
+  if (cached != NULL) {
+    Sprites::drawBitmap(sx, sy, spriteCache + cached->offset, NULL,
+                        w, rows * 8,
+                        color ? SPRITE_IS_MASK : SPRITE_IS_MASK_ERASE);
+    return;
+  }
+#endif
+
+  markDirty(left, top, w, rows * 8);
+
+  // each page row is decompressed then drawn like a bitmap row
+  BlitArea area;
+  uint8_t row[256];
+
+  if (!blitClip(&area, left, top, w, rows, clipLeft, clipTop, clipRight,
+                clipBottom, targetWidth))
+    return;
+  color = color ? WHITE : BLACK;
+
+  // the pixels of a page row, counted down the columns, and those on the
+  // display
+  uint16_t rowLength = w * 8;
+  uint16_t visibleFirst = area.firstColumn * 8;
+  uint16_t visibleLast = (area.firstColumn + area.count) * 8;
+  uint16_t pos = 0;
+  int16_t a = 0;
+
+  memset(row + area.firstColumn, 0, area.count);
+  while (a < area.lastRow) // the rows below aren't needed
+  {
+    uint32_t len = compressedSpan(&reader);
+
+    // add the span to the rows it's on, only the visible part is written
+    while (len > 0 && a < area.lastRow)
+    {
+      uint16_t n = min(len, (uint32_t)(rowLength - pos));
+
+      if (col && a >= area.firstRow) {
+        uint16_t first = max(pos, visibleFirst);
+        uint16_t last = min((uint16_t)(pos + n), visibleLast);
+
+        if (first < last)
+          compressedSetBits(row, first, last);
+      }
+      pos += n;
+      len -= n;
+
+      if (pos == rowLength) // reached end of the page row
+      {
+        if (a >= area.firstRow) {
+          blitClippedRow(&area, a, row + area.firstColumn, left, color);
+          memset(row + area.firstColumn, 0, area.count);
+        }
+        pos = 0;
+        a++;
+      }
+    }
+
+    col = 1 - col; // toggle colour for next span
+  }
+}
+
+void MicroGamerBase::display()
+{
+  uint8_t *image = sBuffer;
+  DisplayWindow windows[HEIGHT / 8];
+  uint8_t count;
+  bool dropped = false;
+  unsigned long waitStart;
+
+#if MICROGAMER_DISPLAY_LIST_SIZE
+  paintDisplayList();
+  return;
+#endif
+
+  if (dropFrames && frameBufferCount > 1 && cancelQueuedPaint()) {
+    // this frame replaces the one that was waiting to be sent
+    dropped = true;
+    framesDroppedCount++;
+    displayedIndex = previousDisplayedIndex;
+    if (startLineQueued) {
+      startLineChanged = true;
+    }
+  }
+
+  if (!trackDirty) {
+    windows[0].firstColumn = 0;
+    windows[0].lastColumn = WIDTH - 1;
+    windows[0].firstPage = 0;
+    windows[0].lastPage = (HEIGHT / 8) - 1;
+    count = 1;
+    lastDisplayByteCount = WIDTH * HEIGHT / 8;
+  }
+  else {
+    // send what differs from the latest frame displayed, and also what the
+    // dropped frame would have sent since the display won't have it
+    PageSpans *pending = &pendingSpans[bufferIndex];
+
+    spansAdd(pending, &dirty);
+    spansAdd(&drawnSpans[bufferIndex], &dirty);
+    spansClear(&dirty);
+    if (dropped) {
+      spansAdd(pending, &displayedSpans);
+    }
+
+    // The buffer of the latest frame displayed isn't drawn on while it's
+    // being sent or queued, so it can be compared with. Without this the
+    // spans of the buffers would keep adding to each other.
+    if (displayedIndex != bufferIndex) {
+      spansTrim(pending, image, frameBuffers[displayedIndex]);
+    }
+    spansAdd(pending, &resendSpans);
+    spansClear(&resendSpans);
+
+    // the other buffers now also differ from the display where this one
+    // is sent, or where the dropped one isn't
+    for (uint8_t i = 0; i < frameBufferCount; i++) {
+      if (i != bufferIndex) {
+        spansAdd(&pendingSpans[i], pending);
+        if (dropped) {
+          spansAdd(&pendingSpans[i], &displayedSpans);
+        }
+      }
+    }
+
+    count = spansToWindows(pending, windows, &lastDisplayByteCount);
+    displayBytesSavedCount += (WIDTH * HEIGHT / 8) - lastDisplayByteCount;
+    displayedSpans = *pending;
+    spansClear(pending);
+  }
+
+  waitStart = micros();
+
+  if (frameBufferCount == 1) {
+    waitEndOfPaintScreen();
+  }
+  paintWindows(image, windows, count, frameStartLine());
+  if (count != 0) {
+    // otherwise this frame is the same as the latest one displayed, whose
+    // buffer is still the one to compare with
+    previousDisplayedIndex = displayedIndex;
+    displayedIndex = bufferIndex;
+  }
+
+  if (frameBufferCount > 1) {
+    // continue drawing on a buffer that isn't needed by the display
+    uint8_t next = bufferIndex;
+
+    do {
+      if (++next == frameBufferCount) {
+        next = 0;
+      }
+      if (next == bufferIndex) {
+        idle();
+      }
+    } while (next == bufferIndex || paintImageInUse(frameBuffers[next]));
+
+    bufferIndex = next;
+    sBuffer = frameBuffers[next];
+  }
+
+  busWaitMicros += micros() - waitStart;
+}
+
+void MicroGamerBase::display(bool clear)
+{
+  display();
+  if (clear) {
+    this->clear();
+  }
+}
+
+void MicroGamerBase::waitDisplayUpdate()
+{
+  unsigned long waitStart = micros();
+
+  waitEndOfPaintScreen();
+  busWaitMicros += micros() - waitStart;
+}
+
+void MicroGamerBase::enableDoubleBuffer()
+{
+  if (frameBufferCount == 1 && !MICROGAMER_DISPLAY_LIST_SIZE) {
+    frameBuffers[1] = (uint8_t *) malloc(((HEIGHT * WIDTH) / 8) * sizeof(uint8_t));
+    if (frameBuffers[1] == NULL) {
+      return;
+    }
+    frameBufferCount = 2;
+
+    // the content of the new buffer is unknown
+    spansFill(&drawnSpans[1]);
+    spansFill(&pendingSpans[1]);
+  }
+}
+
+bool MicroGamerBase::doubleBuffer()
+{
+  return frameBufferCount > 1;
+}
+
+void MicroGamerBase::enableFrameDropping()
+{
+  dropFrames = true;
+}
+
+bool MicroGamerBase::frameDropping()
+{
+  return dropFrames;
+}
+
+unsigned long MicroGamerBase::framesDropped()
+{
+  return framesDroppedCount;
+}
+
+void MicroGamerBase::enableDirtyTracking()
+{
+  if (!trackDirty) {
+    trackDirty = true;
+
+    // nothing is known about what was drawn before
+    for (uint8_t i = 0; i < FRAME_BUFFERS_MAX; i++) {
+      spansFill(&drawnSpans[i]);
+      spansFill(&pendingSpans[i]);
+    }
+  }
+}
+
+bool MicroGamerBase::dirtyTracking()
+{
+  return trackDirty;
+}
+
+void MicroGamerBase::markDirty(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+  int16_t xEnd = x + w;
+  int16_t yEnd = y + h;
+
+  // only the display buffer is tracked
+  if (renderTarget != NULL)
+    return;
+
+  if (x < 0)
+    x = 0;
+  if (y < 0)
+    y = 0;
+  if (xEnd > WIDTH)
+    xEnd = WIDTH;
+  if (yEnd > HEIGHT)
+    yEnd = HEIGHT;
+
+  if (x >= xEnd || y >= yEnd)
+    return;
 
-    drawFastHLine(a, y, b-a+1, color);
+  for (uint8_t page = y / 8; page <= (yEnd - 1) / 8; page++) {
+    spansMark(&dirty, page, x, xEnd - 1);
   }
 }
 
-void MicroGamerBase::drawBitmap
-(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t w, uint8_t h,
- uint8_t color)
-{
-  // no need to draw at all if we're offscreen
-  if (x+w < 0 || x > WIDTH-1 || y+h < 0 || y > HEIGHT-1)
-    return;
+uint16_t MicroGamerBase::lastDisplayBytes()
+{
+  return lastDisplayByteCount;
+}
+
+unsigned long MicroGamerBase::displayBytesSaved()
+{
+  return displayBytesSavedCount;
+}
+
+/* Buffer scrolling */
+
+// Move the rows top to bottom - 1 of count columns from left of a page laid
+// out buffer of the given width and pages down by dy rows, or up if dy is
+// negative. The bits of each byte are shifted with those of the byte in the
+// page above or below, 4 columns at a time once the destination is aligned.
+// Rows moved in from outside the area are left to be filled by the caller.
+static void scrollRows(uint8_t *buffer, int16_t width, int16_t pages,
+                       int16_t left, int16_t count, int16_t top,
+                       int16_t bottom, int16_t dy)
+{
+  bool down = (dy > 0);
+  int16_t distance = down ? dy : -dy;
+  int16_t skip = distance / 8;
+  uint8_t shift = distance & 7;
+  int16_t firstPage = top / 8;
+  int16_t lastPage = (bottom - 1) / 8;
+
+  // Moving down, each page is made of the page skip pages above it shifted
+  // down and the one above that, working up from the bottom so the pages
+  // are read before they're changed. Moving up is the other way round.
+  uint8_t nearKeep = down ? (0xFF << shift) : (0xFF >> shift);
+  uint8_t farKeep = down ? (0xFF >> (8 - shift)) : (0xFF << (8 - shift));
+  uint32_t nearKeepWord = 0x01010101 * nearKeep;
+  uint32_t farKeepWord = 0x01010101 * farKeep;
+
+  for (int16_t i = 0; i <= lastPage - firstPage; i++) {
+    int16_t page = down ? lastPage - i : firstPage + i;
+    int16_t nearPage = down ? page - skip : page + skip;
+    int16_t farPage = down ? nearPage - 1 : nearPage + 1;
+    uint8_t *dst = buffer + (page * width) + left;
+    const uint8_t *nearSrc = (nearPage >= 0 && nearPage < pages) ?
+                             buffer + (nearPage * width) + left : NULL;
+    const uint8_t *farSrc = (farPage >= 0 && farPage < pages && shift != 0) ?
+                            buffer + (farPage * width) + left : NULL;
+    int16_t n = count;
+
+    // the rows of the page in the area
+    uint8_t mask = 0xFF;
+    if (page == firstPage)
+      mask &= 0xFF << (top & 7);
+    if (page == lastPage)
+      mask &= 0xFF >> (7 - ((bottom - 1) & 7));
+    uint32_t maskWord = 0x01010101 * mask;
+
+    // single bytes up to the first aligned word
+    for (; n > 0 && ((uintptr_t)dst & 3) != 0; n--) {
+      uint8_t nearBits = (nearSrc != NULL) ? *nearSrc++ : 0;
+      uint8_t farBits = (farSrc != NULL) ? *farSrc++ : 0;
+      uint8_t bits = down ?
+                     ((nearBits << shift) | (farBits >> (8 - shift))) :
+                     ((nearBits >> shift) | (farBits << (8 - shift)));
+      *dst = (*dst & ~mask) | (bits & mask);
+      dst++;
+    }
 
-  int yOffset = abs(y) % 8;
-  int sRow = y / 8;
-  if (y < 0) {
-    sRow--;
-    yOffset = 8 - yOffset;
-  }
-  int rows = h/8;
-  if (h%8!=0) rows++;
-  for (int a = 0; a < rows; a++) {
-    int bRow = sRow + a;
-    if (bRow > (HEIGHT/8)-1) break;
-    if (bRow > -2) {
-      for (int iCol = 0; iCol<w; iCol++) {
-        if (iCol + x > (WIDTH-1)) break;
-        if (iCol + x >= 0) {
-          if (bRow >= 0) {
-            if (color == WHITE)
-              sBuffer[(bRow*WIDTH) + x + iCol] |= pgm_read_byte(bitmap+(a*w)+iCol) << yOffset;
-            else if (color == BLACK)
-              sBuffer[(bRow*WIDTH) + x + iCol] &= ~(pgm_read_byte(bitmap+(a*w)+iCol) << yOffset);
-            else
-              sBuffer[(bRow*WIDTH) + x + iCol] ^= pgm_read_byte(bitmap+(a*w)+iCol) << yOffset;
-          }
-          if (yOffset && bRow<(HEIGHT/8)-1 && bRow > -2) {
-            if (color == WHITE)
-              sBuffer[((bRow+1)*WIDTH) + x + iCol] |= pgm_read_byte(bitmap+(a*w)+iCol) >> (8-yOffset);
-            else if (color == BLACK)
-              sBuffer[((bRow+1)*WIDTH) + x + iCol] &= ~(pgm_read_byte(bitmap+(a*w)+iCol) >> (8-yOffset));
-            else
-              sBuffer[((bRow+1)*WIDTH) + x + iCol] ^= pgm_read_byte(bitmap+(a*w)+iCol) >> (8-yOffset);
-          }
-        }
+    bool nearAligned = ((uintptr_t)nearSrc & 3) == 0;
+    bool farAligned = ((uintptr_t)farSrc & 3) == 0;
+
+    for (; n >= 4; n -= 4) {
+      uint32_t nearBits = 0;
+      uint32_t farBits = 0;
+      uint32_t word;
+
+      if (nearSrc != NULL) {
+        nearBits = blitLoadWord(nearSrc, nearAligned);
+        nearSrc += 4;
+      }
+      if (farSrc != NULL) {
+        farBits = blitLoadWord(farSrc, farAligned);
+        farSrc += 4;
       }
+
+      uint32_t bits = down ?
+                      (((nearBits << shift) & nearKeepWord) |
+                       ((farBits >> (8 - shift)) & farKeepWord)) :
+                      (((nearBits >> shift) & nearKeepWord) |
+                       ((farBits << (8 - shift)) & farKeepWord));
+
+      memcpy(&word, __builtin_assume_aligned(dst, 4), 4);
+      word = (word & ~maskWord) | (bits & maskWord);
+      memcpy(__builtin_assume_aligned(dst, 4), &word, 4);
+      dst += 4;
+    }
+
+    // the bytes left after the last whole word
+    for (; n > 0; n--) {
+      uint8_t nearBits = (nearSrc != NULL) ? *nearSrc++ : 0;
+      uint8_t farBits = (farSrc != NULL) ? *farSrc++ : 0;
+      uint8_t bits = down ?
+                     ((nearBits << shift) | (farBits >> (8 - shift))) :
+                     ((nearBits >> shift) | (farBits << (8 - shift)));
+      *dst = (*dst & ~mask) | (bits & mask);
+      dst++;
     }
   }
 }
 
-void MicroGamerBase::drawSlowXYBitmap
-(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t w, uint8_t h, uint8_t color)
+// Move the count columns from left of the rows top to bottom - 1 of a page
+// laid out buffer right by dx columns, or left if dx is negative. Columns
+// moved in from outside the area are left to be filled by the caller.
+static void scrollColumns(uint8_t *buffer, int16_t width, int16_t left,
+                          int16_t count, int16_t top, int16_t bottom,
+                          int16_t dx)
 {
-  // no need to draw at all of we're offscreen
-  if (x+w < 0 || x > WIDTH-1 || y+h < 0 || y > HEIGHT-1)
-    return;
+  int16_t firstPage = top / 8;
+  int16_t lastPage = (bottom - 1) / 8;
+  int16_t from = (dx > 0) ? 0 : -dx;
+  int16_t to = (dx > 0) ? dx : 0;
+  int16_t moved = count - from - to;
 
-  int16_t xi, yi, byteWidth = (w + 7) / 8;
-  for(yi = 0; yi < h; yi++) {
-    for(xi = 0; xi < w; xi++ ) {
-      if(pgm_read_byte(bitmap + yi * byteWidth + xi / 8) & (128 >> (xi & 7))) {
-        drawPixel(x + xi, y + yi, color);
-      }
+  for (int16_t page = firstPage; page <= lastPage; page++) {
+    uint8_t *row = buffer + (page * width) + left;
+
+    uint8_t mask = 0xFF;
+    if (page == firstPage)
+      mask &= 0xFF << (top & 7);
+    if (page == lastPage)
+      mask &= 0xFF >> (7 - ((bottom - 1) & 7));
+
+    if (mask == 0xFF) {
+      memmove(row + to, row + from, moved);
+    }
+    else if (dx > 0) {
+      // only some rows of the page move, working back from the right
+      for (int16_t i = moved - 1; i >= 0; i--)
+        row[to + i] = (row[to + i] & ~mask) | (row[from + i] & mask);
+    }
+    else {
+      for (int16_t i = 0; i < moved; i++)
+        row[to + i] = (row[to + i] & ~mask) | (row[from + i] & mask);
     }
   }
 }
 
-typedef struct CSESSION {
-  int byte;
-  int bit;
-  const uint8_t *src;
-  int src_pos;
-} CSESSION;
-static CSESSION cs;
+// Add an area to the array of exposed areas, if there is one, and return
+// the number of areas
+static uint8_t scrollExposed(Rect *exposed, uint8_t count, int16_t x,
+                             int16_t y, int16_t w, int16_t h)
+{
+  if (exposed != NULL) {
+    exposed[count].x = x;
+    exposed[count].y = y;
+    exposed[count].width = w;
+    exposed[count].height = h;
+  }
+  return count + 1;
+}
 
-static int getval(int bits)
+uint8_t MicroGamerBase::scroll(int16_t dx, int16_t dy, uint8_t fill,
+                               Rect *exposed)
 {
-  int val = 0;
-  int i;
-  for (i = 0; i < bits; i++)
-  {
-    if (cs.bit == 0x100)
-    {
-      cs.bit = 0x1;
-      cs.byte = pgm_read_byte(&cs.src[cs.src_pos]);
-      cs.src_pos ++;
+  int16_t h = clipBottom - clipTop;
+  return scrollRect(clipLeft - view.originX, clipTop - view.originY,
+                    clipRight - clipLeft, (h < 255) ? h : 255, dx, dy, fill,
+                    exposed);
+}
+
+uint8_t MicroGamerBase::scrollRect
+(int16_t x, int16_t y, uint8_t w, uint8_t h, int16_t dx, int16_t dy,
+ uint8_t fill, Rect *exposed)
+{
+#if MICROGAMER_DISPLAY_LIST_SIZE
+  // there's no complete display buffer to move
+  if (renderTarget == NULL)
+    return 0;
+#endif
+
+  // the area in target coordinates, clipped to the clip area
+  int16_t originX = view.originX;
+  int16_t originY = view.originY;
+  x += originX;
+  y += originY;
+  int16_t left = (x > clipLeft) ? x : clipLeft;
+  int16_t right = (x + w < clipRight) ? x + w : clipRight;
+  int16_t top = (y > clipTop) ? y : clipTop;
+  int16_t bottom = (y + h < clipBottom) ? y + h : clipBottom;
+
+  if (left >= right || top >= bottom)
+    return 0;
+
+  int16_t width = right - left;
+  int16_t height = bottom - top;
+
+  markDirty(left, top, width, height);
+
+  if (dx <= -width || dx >= width || dy <= -height || dy >= height) {
+    // all of the image moves out of the area
+    fillTargetSpan(left, top, right - 1, bottom - 1, fill);
+    return scrollExposed(exposed, 0, left - originX, top - originY,
+                         width, height);
+  }
+
+  if (dy != 0) {
+    scrollRows(sBuffer, targetWidth, (targetHeight + 7) / 8, left, width,
+               top, bottom, dy);
+  }
+  if (dx != 0)
+    scrollColumns(sBuffer, targetWidth, left, width, top, bottom, dx);
+
+  // the strip across the area left by the vertical move, then the one
+  // beside it left by the horizontal move, given in drawing coordinates
+  uint8_t count = 0;
+
+  if (dy > 0) {
+    fillTargetSpan(left, top, right - 1, top + dy - 1, fill);
+    count = scrollExposed(exposed, count, left - originX, top - originY,
+                          width, dy);
+    top += dy;
+  }
+  else if (dy < 0) {
+    fillTargetSpan(left, bottom + dy, right - 1, bottom - 1, fill);
+    count = scrollExposed(exposed, count, left - originX,
+                          bottom + dy - originY, width, -dy);
+    bottom += dy;
+  }
+
+  if (dx > 0) {
+    fillTargetSpan(left, top, left + dx - 1, bottom - 1, fill);
+    count = scrollExposed(exposed, count, left - originX, top - originY,
+                          dx, bottom - top);
+  }
+  else if (dx < 0) {
+    fillTargetSpan(right + dx, top, right - 1, bottom - 1, fill);
+    count = scrollExposed(exposed, count, right + dx - originX,
+                          top - originY, -dx, bottom - top);
+  }
+
+  return count;
+}
+
+void MicroGamerBase::scrollVertical(int8_t dy)
+{
+  startLine = (startLine + dy) & (HEIGHT - 1);
+  startLineChanged = true;
+}
+
+uint8_t MicroGamerBase::scrollY()
+{
+  return startLine;
+}
+
+int16_t MicroGamerBase::bufferY(int16_t y)
+{
+  return (y + startLine) & (HEIGHT - 1);
+}
+
+void MicroGamerBase::setShake(int8_t dy)
+{
+  setDisplayOffset(dy & (HEIGHT - 1));
+}
+
+void MicroGamerBase::resendPages(uint8_t firstPage, uint8_t lastPage)
+{
+  for (uint8_t page = firstPage; page <= lastPage && page < HEIGHT / 8;
+       page++) {
+    spansMark(&resendSpans, page, 0, WIDTH - 1);
+  }
+}
+
+int8_t MicroGamerBase::frameStartLine()
+{
+  // sent along with the frame drawn for it, ahead of its data
+  startLineQueued = startLineChanged;
+  if (!startLineChanged) {
+    return -1;
+  }
+  startLineChanged = false;
+  return startLine;
+}
+
+bool MicroGamerBase::displayListOverflow()
+{
+#if MICROGAMER_DISPLAY_LIST_SIZE
+  return displayListFull;
+#else
+  return false;
+#endif
+}
+
+unsigned long MicroGamerBase::spriteCacheHits()
+{
+#if MICROGAMER_SPRITE_CACHE_SIZE
+  return spriteCacheHitCount;
+#else
+  return 0;
+#endif
+}
+
+unsigned long MicroGamerBase::spriteCacheMisses()
+{
+#if MICROGAMER_SPRITE_CACHE_SIZE
+  return spriteCacheMissCount;
+#else
+  return 0;
+#endif
+}
+
+void MicroGamerBase::clearSpriteCache()
+{
+#if MICROGAMER_SPRITE_CACHE_SIZE
+  spriteCacheCount = 0;
+  spriteCacheUsed = 0;
+  spriteCacheHitCount = 0;
+  spriteCacheMissCount = 0;
+#endif
+}
+
+#if MICROGAMER_SPRITE_CACHE_SIZE
+
+/* Sprite cache */
+
+MicroGamerBase::SpriteCacheEntry *MicroGamerBase::spriteCacheFind
+(const uint8_t *bitmap, uint8_t frame)
+{
+  for (uint8_t i = 0; i < spriteCacheCount; i++) {
+    SpriteCacheEntry *entry = &spriteCacheEntries[i];
+
+    if ((entry->source == bitmap && entry->frame == frame) ||
+        (entry->start == bitmap && frame == 0)) {
+      // move it to the front
+      SpriteCacheEntry found = *entry;
+      memmove(&spriteCacheEntries[1], &spriteCacheEntries[0],
+              i * sizeof(SpriteCacheEntry));
+      spriteCacheEntries[0] = found;
+      return &spriteCacheEntries[0];
     }
-    if (cs.byte & cs.bit)
-      val += (1 << i);
-    cs.bit <<= 1;
   }
-  return val;
+  return NULL;
 }
 
-void MicroGamerBase::drawCompressed(int16_t sx, int16_t sy, const uint8_t *bitmap, uint8_t color)
+MicroGamerBase::SpriteCacheEntry *MicroGamerBase::spriteCacheAdd
+(const uint8_t *source, uint8_t frame, const uint8_t *start,
+ uint8_t width, uint8_t height, uint16_t size)
 {
-  int bl, len;
-  int col;
-  int i;
-  int a, iCol;
-  int byte = 0;
-  int bit = 0;
-  int w, h;
+  // remove the least recently used images, closing the gaps they leave
+  while (spriteCacheCount == MICROGAMER_SPRITE_CACHE_ENTRIES ||
+         spriteCacheUsed + size > MICROGAMER_SPRITE_CACHE_SIZE) {
+    SpriteCacheEntry *last = &spriteCacheEntries[--spriteCacheCount];
+    uint16_t end = last->offset + last->size;
+
+    memmove(spriteCache + last->offset, spriteCache + end,
+            spriteCacheUsed - end);
+    spriteCacheUsed -= last->size;
+    for (uint8_t i = 0; i < spriteCacheCount; i++) {
+      if (spriteCacheEntries[i].offset > last->offset)
+        spriteCacheEntries[i].offset -= last->size;
+    }
+  }
 
-  // set up decompress state
+  memmove(&spriteCacheEntries[1], &spriteCacheEntries[0],
+          spriteCacheCount * sizeof(SpriteCacheEntry));
+  spriteCacheCount++;
 
-  cs.src = bitmap;
-  cs.bit = 0x100;
-  cs.byte = 0;
-  cs.src_pos = 0;
+  SpriteCacheEntry *entry = &spriteCacheEntries[0];
+  entry->source = source;
+  entry->start = start;
+  entry->offset = spriteCacheUsed;
+  entry->size = size;
+  entry->frame = frame;
+  entry->width = width;
+  entry->height = height;
+  spriteCacheUsed += size;
+  return entry;
+}
 
-  // read header
+#endif
 
-  w = getval(8) + 1;
-  h = getval(8) + 1;
+#if MICROGAMER_DISPLAY_LIST_SIZE
 
-  col = getval(1); // starting colour
+/* Display list */
 
-  // no need to draw at all if we're offscreen
-  if (sx + w < 0 || sx > WIDTH - 1 || sy + h < 0 || sy > HEIGHT - 1)
-    return;
+bool MicroGamerBase::recordDrawCall(uint8_t op, int16_t top, int16_t bottom,
+                                    const int16_t *args, uint8_t argCount,
+                                    const uint8_t *bitmap,
+                                    const uint8_t *mask)
+{
+  // surfaces are drawn on right away
+  if (replayingDisplayList || renderTarget != NULL) {
+    return false;
+  }
 
-  // sy = sy - (frame*h);
+  // nothing to draw if the rows are all outside of the clip area
+  int32_t first = (int32_t)top + view.originY;
+  int32_t last = (int32_t)bottom + view.originY;
 
-  int yOffset = abs(sy) % 8;
-  int sRow = sy / 8;
-  if (sy < 0) {
-    sRow--;
-    yOffset = 8 - yOffset;
+  if (last < clipTop || first > clipBottom - 1 || last < first) {
+    return true;
   }
-  int rows = h / 8;
-  if (h % 8 != 0) rows++;
+  if (first < clipTop)
+    first = clipTop;
+  if (last > clipBottom - 1)
+    last = clipBottom - 1;
 
-  a = 0; // +(frame*rows);
-  iCol = 0;
+  return recordEntry(op, (0xFF << (first / 8)) & (0xFF >> (7 - (last / 8))),
+                     args, argCount, bitmap, mask);
+}
 
-  byte = 0; bit = 1;
-  while (a < rows) // + (frame*rows))
-  {
-    bl = 1;
-    while (!getval(1))
-      bl += 2;
+bool MicroGamerBase::recordEntry(uint8_t op, uint8_t pageMask,
+                                 const int16_t *args, uint8_t argCount,
+                                 const uint8_t *bitmap, const uint8_t *mask)
+{
+  if (replayingDisplayList || renderTarget != NULL) {
+    return false;
+  }
 
-    len = getval(bl) + 1; // span length
+  // An entry is the operation, a mask of the pages it draws on, the number
+  // of arguments and pointers, then the arguments and pointers themselves.
+  uint8_t pointerCount = mask != NULL ? 2 : (bitmap != NULL ? 1 : 0);
+  uint16_t size = 3 + (argCount * sizeof(int16_t)) +
+                  (pointerCount * sizeof(const uint8_t *));
+  uint8_t *entry = displayList + displayListLength;
 
-    // draw the span
+  if (displayListLength + size > MICROGAMER_DISPLAY_LIST_SIZE) {
+    displayListFull = true;
+    return true;
+  }
 
+  entry[0] = op;
+  entry[1] = pageMask;
+  entry[2] = argCount | (pointerCount << 4);
+  memcpy(entry + 3, args, argCount * sizeof(int16_t));
+  entry += 3 + (argCount * sizeof(int16_t));
+  if (pointerCount > 0)
+    memcpy(entry, &bitmap, sizeof(const uint8_t *));
+  if (pointerCount > 1)
+    memcpy(entry + sizeof(const uint8_t *), &mask, sizeof(const uint8_t *));
+
+  displayListLength += size;
+  return true;
+}
 
-    for (i = 0; i < len; i++)
-    {
-      if (col)
-        byte |= bit;
-      bit <<= 1;
+void MicroGamerBase::drawDisplayListEntry(uint8_t op, const int16_t *a,
+                                          const uint8_t * const *pointers)
+{
+  switch (op) {
+    case DL_DRAW_PIXEL: drawPixel(a[0], a[1], a[2]); break;
+    case DL_DRAW_CIRCLE: drawCircle(a[0], a[1], a[2], a[3]); break;
+    case DL_DRAW_CIRCLE_HELPER: drawCircleHelper(a[0], a[1], a[2], a[3], a[4]); break;
+    case DL_FILL_CIRCLE: fillCircle(a[0], a[1], a[2], a[3]); break;
+    case DL_FILL_CIRCLE_PATTERN:
+      fillCircle(a[0], a[1], a[2], pointers[0], a[3]);
+      break;
+    case DL_FILL_CIRCLE_HELPER: fillCircleHelper(a[0], a[1], a[2], a[3], a[4], a[5]); break;
+    case DL_DRAW_ELLIPSE: drawEllipse(a[0], a[1], a[2], a[3], a[4]); break;
+    case DL_FILL_ELLIPSE: fillEllipse(a[0], a[1], a[2], a[3], a[4]); break;
+    case DL_DRAW_ARC: drawArc(a[0], a[1], a[2], a[3], a[4], a[5]); break;
+    case DL_DRAW_LINE: drawLine(a[0], a[1], a[2], a[3], a[4]); break;
+    case DL_DRAW_POLYLINE:
+      drawPolyline((const Point *)pointers[0], a[0], a[1]);
+      break;
+    case DL_DRAW_LINES:
+      drawLines((const Point *)pointers[0], a[0], a[1]);
+      break;
+    case DL_DRAW_RECT: drawRect(a[0], a[1], a[2], a[3], a[4]); break;
+    case DL_DRAW_FAST_VLINE: drawFastVLine(a[0], a[1], a[2], a[3]); break;
+    case DL_DRAW_FAST_HLINE: drawFastHLine(a[0], a[1], a[2], a[3]); break;
+    case DL_FILL_RECT: fillRect(a[0], a[1], a[2], a[3], a[4]); break;
+    case DL_FILL_RECT_PATTERN:
+      fillRect(a[0], a[1], a[2], a[3], pointers[0], a[4]);
+      break;
+    case DL_FILL_SCREEN: fillScreen(a[0]); break;
+    case DL_FILL_SCREEN_PATTERN: fillScreen(pointers[0], a[0]); break;
+    case DL_DRAW_ROUND_RECT: drawRoundRect(a[0], a[1], a[2], a[3], a[4], a[5]); break;
+    case DL_FILL_ROUND_RECT: fillRoundRect(a[0], a[1], a[2], a[3], a[4], a[5]); break;
+    case DL_FILL_ROUND_RECT_PATTERN:
+      fillRoundRect(a[0], a[1], a[2], a[3], a[4], pointers[0], a[5]);
+      break;
+    case DL_DRAW_TRIANGLE: drawTriangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6]); break;
+    case DL_FILL_TRIANGLE: fillTriangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6]); break;
+    case DL_FILL_TRIANGLE_PATTERN:
+      fillTriangle(a[0], a[1], a[2], a[3], a[4], a[5], pointers[0], a[6]);
+      break;
+    case DL_FILL_POLYGON:
+      fillPolygon((const Point *)pointers[0], a[0], a[1]);
+      break;
+    case DL_DRAW_BITMAP: drawBitmap(a[0], a[1], pointers[0], a[2], a[3], a[4]); break;
+    case DL_DRAW_SURFACE:
+      drawSurface(a[0], a[1], (const Surface *)pointers[0], a[2]);
+      break;
+    case DL_DRAW_TILEMAP:
+      drawTilemap((const Tilemap *)pointers[0], a[0], a[1], a[2]);
+      break;
+    case DL_DRAW_SLOW_XY_BITMAP: drawSlowXYBitmap(a[0], a[1], pointers[0], a[2], a[3], a[4]); break;
+    case DL_DRAW_COMPRESSED: drawCompressed(a[0], a[1], pointers[0], a[2]); break;
+    case DL_SPRITES_DRAW_BITMAP:
+      Sprites::drawBitmap(a[0], a[1], pointers[0], pointers[1], a[2], a[3], a[4]);
+      break;
+    case DL_SPRITES_DRAW_TRANSFORMED:
+      Sprites::drawTransformed(a[0], a[1], pointers[0], a[2], pointers[1], a[3],
+                               a[4], a[5], a[6]);
+      break;
+    case DL_SET_CLIP_RECT: setClipRect(a[0], a[1], a[2], a[3]); break;
+    case DL_SET_ORIGIN: setOrigin(a[0], a[1]); break;
+  }
+}
 
-      if (bit == 0x100) // reached end of byte
-      {
-        // draw
-
-        int bRow = sRow + a;
-
-        //if (byte) // possible optimisation
-        if (bRow <= (HEIGHT / 8) - 1)
-          if (bRow > -2)
-            if (iCol + sx <= (WIDTH - 1))
-              if (iCol + sx >= 0) {
-
-                if (bRow >= 0)
-                {
-                  if (color)
-                    sBuffer[(bRow * WIDTH) + sx + iCol] |= byte << yOffset;
-                  else
-                    sBuffer[(bRow * WIDTH) + sx + iCol] &= ~(byte << yOffset);
-                }
-                if (yOffset && bRow < (HEIGHT / 8) - 1 && bRow > -2)
-                {
-                  if (color)
-                    sBuffer[((bRow + 1)*WIDTH) + sx + iCol] |= byte >> (8 - yOffset);
-                  else
-                    sBuffer[((bRow + 1)*WIDTH) + sx + iCol] &= ~(byte >> (8 - yOffset));
-                }
-              }
-
-        // iterate
-        iCol ++;
-        if (iCol >= w)
-        {
-          iCol = 0;
-          a ++;
-        }
+void MicroGamerBase::paintDisplayList()
+{
+  DisplayWindow window = { 0, WIDTH - 1, 0, 0 };
+  unsigned long waitStart;
+  ViewState drawnView = view;
 
-        // reset byte
-        byte = 0; bit = 1;
-      }
+  replayingDisplayList = true;
+
+  for (uint8_t page = 0; page < HEIGHT / 8; page++) {
+    uint8_t *stripe = displayListStripes[page & 1];
+    // The stripe is used as the page of an image starting that many pages
+    // before it, so that the drawing functions and paintWindows() can index
+    // it as a full display buffer.
+    uint8_t *image = stripe - (page * WIDTH);
+
+    // wait for the stripe to be sent, two pages ago or at the end of the
+    // previous frame
+    waitStart = micros();
+    while (paintImageInUse(stripe - (((page - 2) & 7) * WIDTH))) {
+      idle();
+    }
+    busWaitMicros += micros() - waitStart;
+
+    memset(stripe, 0, WIDTH);
+    sBuffer = image;
+    // each page is drawn from the view the list started with
+    view = displayListView;
+    bandTop = page * 8;
+    bandBottom = bandTop + 8;
+    updateClip();
+
+    uint8_t pageMask = 1 << page;
+    uint16_t pos = 0;
+
+    while (pos < displayListLength) {
+      const uint8_t *entry = displayList + pos;
+      uint8_t argCount = entry[2] & 0x0F;
+      uint8_t pointerCount = entry[2] >> 4;
+      int16_t args[7];
+      const uint8_t *pointers[2] = { NULL, NULL };
+
+      pos += 3 + (argCount * sizeof(int16_t)) +
+             (pointerCount * sizeof(const uint8_t *));
+      if (!(entry[1] & pageMask))
+        continue;
+
+      // the entry isn't aligned
+      memcpy(args, entry + 3, argCount * sizeof(int16_t));
+      memcpy(pointers, entry + 3 + (argCount * sizeof(int16_t)),
+             pointerCount * sizeof(const uint8_t *));
+      drawDisplayListEntry(entry[0], args, pointers);
     }
 
-    col = 1 - col; // toggle colour for next span
+    window.firstPage = page;
+    window.lastPage = page;
+    waitStart = micros();
+    paintWindows(image, &window, 1, page == 0 ? frameStartLine() : -1);
+    busWaitMicros += micros() - waitStart;
   }
+
+  view = drawnView;
+  bandTop = 0;
+  bandBottom = HEIGHT;
+  updateClip();
+  sBuffer = displayListStripes[0];
+  spansClear(&dirty);
+  lastDisplayByteCount = WIDTH * HEIGHT / 8;
+  replayingDisplayList = false;
 }
 
-void MicroGamerBase::display()
+#endif
+
+uint8_t* MicroGamerBase::getBuffer()
 {
-  uint8_t *tmp;
+    return sBuffer;
+}
 
-  waitEndOfPaintScreen();
+void MicroGamerBase::setRenderTarget(Surface *surface)
+{
+  if (renderTarget == NULL)
+    screenBuffer = sBuffer;
 
-  if(displayBuffer != NULL) {
-    tmp = displayBuffer;
-    displayBuffer = sBuffer;
-    sBuffer = tmp;
-    paintScreen(displayBuffer);
-  } else {
-      paintScreen(sBuffer);
+  renderTarget = surface;
+  if (surface != NULL) {
+    sBuffer = surface->buffer;
+    targetWidth = surface->width;
+    targetHeight = surface->pages * 8;
+  }
+  else {
+    sBuffer = screenBuffer;
+    targetWidth = WIDTH;
+    targetHeight = HEIGHT;
   }
+  bandTop = 0;
+  bandBottom = targetHeight;
+
+  // recorded in the display list when going back to the screen, as it may
+  // have been changed by the calls drawn since
+  clearClipRect();
+  setOrigin(0, 0);
 }
 
-void MicroGamerBase::display(bool clear)
+Surface *MicroGamerBase::getRenderTarget()
 {
-  display();
-  if (clear) {
-    this->clear();
+  return renderTarget;
+}
+
+void MicroGamerBase::updateClip()
+{
+  clipLeft = max(view.left, 0);
+  clipRight = min(view.right, targetWidth);
+  clipTop = max(view.top, bandTop);
+  clipBottom = min(view.bottom, bandBottom);
+
+  if (clipLeft >= clipRight || clipTop >= clipBottom) {
+    clipLeft = 0;
+    clipRight = 0;
+    clipTop = 0;
+    clipBottom = 0;
   }
 }
 
-void MicroGamerBase::waitDisplayUpdate()
+void MicroGamerBase::setClipRect(int16_t x, int16_t y, int16_t w, int16_t h)
 {
-  waitEndOfPaintScreen();
+  // the state is recorded for all the pages, and also set now so that the
+  // calls recorded after it are clipped like they'll be drawn
+  int16_t args[] = { x, y, w, h };
+  recordEntry(DL_SET_CLIP_RECT, 0xFF, args, 4, NULL, NULL);
+
+  view.left = x;
+  view.top = y;
+  view.right = x + max(w, 0);
+  view.bottom = y + max(h, 0);
+  updateClip();
 }
 
-void MicroGamerBase::enableDoubleBuffer()
+void MicroGamerBase::clearClipRect()
 {
-  if(displayBuffer == NULL) {
-    displayBuffer = (uint8_t *) malloc(((HEIGHT * WIDTH) / 8) * sizeof(uint8_t));
-  }
+  setClipRect(0, 0, targetWidth, targetHeight);
 }
 
-bool MicroGamerBase::doubleBuffer()
+Rect MicroGamerBase::getClipRect()
 {
-  return displayBuffer != NULL;
+  Rect rect;
+  int16_t top = max(view.top, 0);
+  int16_t bottom = min(view.bottom, targetHeight);
+
+  rect.x = max(view.left, 0);
+  rect.y = top;
+  rect.width = max(min(view.right, targetWidth) - rect.x, 0);
+  rect.height = min(max(bottom - top, 0), 255);
+  return rect;
 }
 
-uint8_t* MicroGamerBase::getBuffer()
+void MicroGamerBase::setOrigin(int16_t x, int16_t y)
 {
-    return sBuffer;
+  int16_t args[] = { x, y };
+  recordEntry(DL_SET_ORIGIN, 0xFF, args, 2, NULL, NULL);
+
+  view.originX = x;
+  view.originY = y;
+}
+
+Point MicroGamerBase::getOrigin()
+{
+  Point origin = { view.originX, view.originY };
+  return origin;
+}
+
+void MicroGamerBase::setViewport(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+  setClipRect(x, y, w, h);
+  setOrigin(x, y);
+}
+
+void MicroGamerBase::clipEdgesSave(ClipEdges *edges, int16_t x,
+                                   uint8_t count)
+{
+  int16_t topPage = clipTop / 8;
+  int16_t bottomPage = (clipBottom - 1) / 8;
+  uint8_t topKeep = ~(0xFF << (clipTop & 7));
+  uint8_t bottomKeep = 0xFF << (((clipBottom - 1) & 7) + 1);
+
+  // both edges can be on the same page
+  if (topPage == bottomPage) {
+    topKeep |= bottomKeep;
+    bottomKeep = 0;
+  }
+
+  edges->count = count;
+  edges->keep[0] = topKeep;
+  edges->keep[1] = bottomKeep;
+  edges->pages[0] = (topKeep != 0) ?
+                    sBuffer + (topPage * targetWidth) + x : NULL;
+  edges->pages[1] = (bottomKeep != 0) ?
+                    sBuffer + (bottomPage * targetWidth) + x : NULL;
+
+  for (uint8_t i = 0; i < 2; i++) {
+    if (edges->pages[i] != NULL)
+      memcpy(edges->bytes[i], edges->pages[i], count);
+  }
+}
+
+void MicroGamerBase::clipEdgesRestore(const ClipEdges *edges)
+{
+  for (uint8_t i = 0; i < 2; i++) {
+    uint8_t *dst = edges->pages[i];
+    uint8_t keep = edges->keep[i];
+
+    if (dst == NULL)
+      continue;
+    for (uint8_t c = 0; c < edges->count; c++)
+      dst[c] = (dst[c] & ~keep) | (edges->bytes[i][c] & keep);
+  }
 }
 
 bool MicroGamerBase::pressed(uint8_t buttons)
@@ -978,6 +3304,145 @@ bool MicroGamerBase::collide(Rect rect1, Rect rect2)
            rect2.y + rect2.height <= rect1.y);
 }
 
+// The pixels of the first bitmap touched by the second in one column,
+// near and far being the bytes of the second bitmap's pages that the page
+// of the first lies across
+static inline uint8_t collideColumn(uint8_t bits, uint8_t mask, uint8_t near,
+                                    uint8_t far, uint8_t shift)
+{
+  return bits & mask & ((near >> shift) | (far << (8 - shift)));
+}
+
+// Set the contact point to the top, then leftmost, pixel of a column's hit
+// bits if it's above or left of the one found so far
+static void collideContact(Point *contact, uint8_t hit, int16_t x, int16_t y,
+                           uint8_t *best)
+{
+  uint8_t bit = __builtin_ctz(hit);
+
+  if (bit < *best) {
+    *best = bit;
+    contact->x = x;
+    contact->y = y + bit;
+  }
+}
+
+bool MicroGamerBase::collide
+(int16_t x1, int16_t y1, const uint8_t *sprite1, uint8_t frame1,
+ int16_t x2, int16_t y2, const uint8_t *sprite2, uint8_t frame2,
+ Point *contact)
+{
+  uint8_t w1 = pgm_read_byte(sprite1);
+  uint8_t h1 = pgm_read_byte(sprite1 + 1);
+  uint8_t w2 = pgm_read_byte(sprite2);
+  uint8_t h2 = pgm_read_byte(sprite2 + 1);
+
+  return collideBitmaps(x1, y1, sprite1 + 2 + frame1 * w1 * ((h1 + 7) / 8),
+                        w1, h1,
+                        x2, y2, sprite2 + 2 + frame2 * w2 * ((h2 + 7) / 8),
+                        w2, h2, contact);
+}
+
+bool MicroGamerBase::collideBitmaps
+(int16_t x1, int16_t y1, const uint8_t *bitmap1, uint8_t w1, uint8_t h1,
+ int16_t x2, int16_t y2, const uint8_t *bitmap2, uint8_t w2, uint8_t h2,
+ Point *contact)
+{
+  // the overlap of the rectangles
+  int16_t left = (x1 > x2) ? x1 : x2;
+  int16_t right = (x1 + w1 < x2 + w2) ? x1 + w1 : x2 + w2;
+  int16_t top = (y1 > y2) ? y1 : y2;
+  int16_t bottom = (y1 + h1 < y2 + h2) ? y1 + h1 : y2 + h2;
+
+  if (left >= right || top >= bottom)
+    return false;
+
+  int16_t count = right - left;
+  int16_t pages2 = (h2 + 7) / 8;
+
+  // Each page of the first bitmap in the overlap is compared with the bits
+  // of the two pages of the second bitmap it lies across, shifted up to
+  // line up with it.
+  for (int16_t page = (top - y1) / 8; page <= (bottom - 1 - y1) / 8; page++) {
+    int16_t row = y1 + (page * 8);
+    int16_t offset = row - y2;
+    int16_t nearPage = (offset >= 0) ? offset / 8 : -1;
+    uint8_t shift = offset - (nearPage * 8);
+
+    // the rows of the page in the overlap
+    uint8_t mask = 0xFF;
+    if (row < top)
+      mask &= 0xFF << (top - row);
+    if (row + 8 > bottom)
+      mask &= 0xFF >> (row + 8 - bottom);
+
+    const uint8_t *src = bitmap1 + (page * w1) + (left - x1);
+    const uint8_t *nearSrc = (nearPage >= 0) ?
+                             bitmap2 + (nearPage * w2) + (left - x2) : NULL;
+    const uint8_t *farSrc = (nearPage + 1 < pages2 && shift != 0) ?
+                            bitmap2 + ((nearPage + 1) * w2) + (left - x2) :
+                            NULL;
+
+    uint8_t best = 8;
+    int16_t x = left;
+    int16_t n = count;
+
+    uint32_t maskWord = 0x01010101 * mask;
+    uint32_t nearKeep = 0x01010101 * (uint8_t)(0xFF >> shift);
+    uint32_t farKeep = 0x01010101 * (uint8_t)(0xFF << (8 - shift));
+    bool aligned = ((uintptr_t)src & 3) == 0;
+    bool nearAligned = ((uintptr_t)nearSrc & 3) == 0;
+    bool farAligned = ((uintptr_t)farSrc & 3) == 0;
+
+    for (; n >= 4; n -= 4, x += 4, src += 4) {
+      uint32_t bits = blitLoadWord(src, aligned) & maskWord;
+      uint32_t nearBits = 0;
+      uint32_t farBits = 0;
+
+      if (nearSrc != NULL) {
+        nearBits = blitLoadWord(nearSrc, nearAligned);
+        nearSrc += 4;
+      }
+      if (farSrc != NULL) {
+        farBits = blitLoadWord(farSrc, farAligned);
+        farSrc += 4;
+      }
+
+      uint32_t hit = bits & (((nearBits >> shift) & nearKeep) |
+                             ((farBits << (8 - shift)) & farKeep));
+      if (hit == 0)
+        continue;
+      if (contact == NULL)
+        return true;
+
+      for (uint8_t i = 0; i < 4; i++, hit >>= 8) {
+        if (hit & 0xFF)
+          collideContact(contact, hit & 0xFF, x + i, row, &best);
+      }
+    }
+
+    // the columns left after the last whole word
+    for (; n > 0; n--, x++) {
+      uint8_t near = (nearSrc != NULL) ? pgm_read_byte(nearSrc++) : 0;
+      uint8_t far = (farSrc != NULL) ? pgm_read_byte(farSrc++) : 0;
+      uint8_t hit = collideColumn(pgm_read_byte(src++), mask, near, far,
+                                  shift);
+      if (hit == 0)
+        continue;
+      if (contact == NULL)
+        return true;
+
+      collideContact(contact, hit, x, row, &best);
+    }
+
+    // the top page row with a hit has the top contact pixel
+    if (best < 8)
+      return true;
+  }
+
+  return false;
+}
+
 uint16_t MicroGamerBase::readUnitID()
 {
     //TODO
@@ -1134,7 +3599,7 @@ size_t MicroGamer::write(uint8_t c)
   {
     drawChar(cursor_x, cursor_y, c, textColor, textBackground, textSize);
     cursor_x += textSize * 6;
-    if (textWrap && (cursor_x > (WIDTH - textSize * 6)))
+    if (textWrap && (cursor_x > (clipRight - view.originX - textSize * 6)))
     {
       // calling ourselves recursively for 'newline' is
       // 12 bytes smaller than doing the same math here
@@ -1144,6 +3609,55 @@ size_t MicroGamer::write(uint8_t c)
   return 1;
 }
 
+const uint16_t MicroGamerBase::expandedNibbles[3][16] PROGMEM = {
+  { 0x0000, 0x0003, 0x000C, 0x000F, 0x0030, 0x0033, 0x003C, 0x003F,
+    0x00C0, 0x00C3, 0x00CC, 0x00CF, 0x00F0, 0x00F3, 0x00FC, 0x00FF },
+  { 0x0000, 0x0007, 0x0038, 0x003F, 0x01C0, 0x01C7, 0x01F8, 0x01FF,
+    0x0E00, 0x0E07, 0x0E38, 0x0E3F, 0x0FC0, 0x0FC7, 0x0FF8, 0x0FFF },
+  { 0x0000, 0x000F, 0x00F0, 0x00FF, 0x0F00, 0x0F0F, 0x0FF0, 0x0FFF,
+    0xF000, 0xF00F, 0xF0F0, 0xF0FF, 0xFF00, 0xFF0F, 0xFFF0, 0xFFFF }
+};
+
+// The pixels of a character column written with a color: bits of `ones` are
+// written where the font column has a 1, bits of `zeros` where it has a 0
+static inline uint32_t textColumnBits(uint32_t column, uint32_t ones,
+                                      uint32_t zeros)
+{
+  return (column & ones) | (~column & zeros);
+}
+
+size_t MicroGamer::write(const uint8_t *buffer, size_t size)
+{
+  int16_t x = cursor_x;
+  int16_t y = cursor_y;
+  int16_t advance = textSize * 6;
+
+  // the cursor is kept in locals and only stored at the end
+  for (size_t i = 0; i < size; i++)
+  {
+    uint8_t c = buffer[i];
+
+    if (c == '\n')
+    {
+      y += textSize * 8;
+      x = 0;
+    }
+    else if (c != '\r')
+    {
+      drawChar(x, y, c, textColor, textBackground, textSize);
+      x += advance;
+      if (textWrap && (x > (clipRight - view.originX - advance)))
+      {
+        y += textSize * 8;
+        x = 0;
+      }
+    }
+  }
+  cursor_x = x;
+  cursor_y = y;
+  return size;
+}
+
 void MicroGamer::drawChar
   (int16_t x, int16_t y, unsigned char c, uint8_t color, uint8_t bg, uint8_t size)
 {
@@ -1151,34 +3665,116 @@ void MicroGamer::drawChar
   bool draw_background = bg != color;
   const unsigned char* bitmap = font + c * 5;
 
-  if ((x >= WIDTH) ||              // Clip right
-      (y >= HEIGHT) ||             // Clip bottom
-      ((x + 5 * size - 1) < 0) ||  // Clip left
-      ((y + 8 * size - 1) < 0)     // Clip top
-     )
-  {
+  if (clippedOut(x, y, 5 * size, 8 * size))
     return;
-  }
 
-  for (uint8_t i = 0; i < 6; i++ )
-  {
-    line = pgm_read_byte(bitmap++);
-    if (i == 5) {
-      line = 0x0;
-    }
+  int16_t args[] = { x, y, c, color, bg, size };
+  if (recordDrawCall(DL_DRAW_CHAR, y, y + (8 * size) - 1, args, 6))
+    return;
 
-    for (uint8_t j = 0; j < 8; j++)
+  if (size > 4) {
+    // the pixels are drawn one by one at large sizes
+    for (uint8_t i = 0; i < 6; i++ )
     {
-      uint8_t draw_color = (line & 0x1) ? color : bg;
+      line = pgm_read_byte(bitmap++);
+      if (i == 5) {
+        line = 0x0;
+      }
+
+      for (uint8_t j = 0; j < 8; j++)
+      {
+        uint8_t draw_color = (line & 0x1) ? color : bg;
 
-      if (draw_color || draw_background) {
-        for (uint8_t a = 0; a < size; a++ ) {
-          for (uint8_t b = 0; b < size; b++ ) {
-            drawPixel(x + (i * size) + a, y + (j * size) + b, draw_color);
+        if (draw_color || draw_background) {
+          for (uint8_t a = 0; a < size; a++ ) {
+            for (uint8_t b = 0; b < size; b++ ) {
+              drawPixel(x + (i * size) + a, y + (j * size) + b, draw_color);
+            }
           }
         }
+        line >>= 1;
+      }
+    }
+    return;
+  }
+
+  // The font columns, stretched down to 8 * size bits. Each one is then
+  // written to the pages it's on with one OR, AND and XOR per byte.
+  uint32_t columns[6];
+  uint32_t cell = (size == 4) ? 0xFFFFFFFF : (1UL << (8 * size)) - 1;
+
+  for (uint8_t i = 0; i < 5; i++) {
+    line = pgm_read_byte(bitmap + i);
+    if (size == 1) {
+      columns[i] = line;
+    }
+    else {
+      const uint16_t *expand = expandedNibbles[size - 2];
+      columns[i] = pgm_read_word(expand + (line & 0x0F)) |
+                   ((uint32_t)pgm_read_word(expand + (line >> 4)) << (4 * size));
+    }
+  }
+  columns[5] = 0;
+
+  // A pixel is drawn with the color, or the background color for font bits
+  // set to 0, unless that color is BLACK and the background isn't drawn.
+  uint32_t fg = (color || draw_background) ? cell : 0;
+  uint32_t back = (bg || draw_background) ? cell : 0;
+  uint32_t setOnes = (color == WHITE) ? fg : 0;
+  uint32_t setZeros = (bg == WHITE) ? back : 0;
+  uint32_t clearOnes = (color == BLACK) ? fg : 0;
+  uint32_t clearZeros = (bg == BLACK) ? back : 0;
+  uint32_t flipOnes = (color == INVERSE) ? fg : 0;
+  uint32_t flipZeros = (bg == INVERSE) ? back : 0;
+
+  if ((fg | back) == 0 || clipBottom <= clipTop)
+    return;
+
+  // the character is clipped and drawn in target coordinates
+  x += view.originX;
+  y += view.originY;
+
+  // the pages the character is on that can be drawn on
+  uint8_t yOffset = y & 7;
+  int16_t page = (y - yOffset) / 8;
+  int16_t firstPage = max(page, clipTop / 8);
+  int16_t lastPage = min((y + (8 * size) - 1) / 8, (clipBottom - 1) / 8);
+
+  // the columns in the clip area
+  int16_t first = max(x, clipLeft);
+  int16_t last = min(x + (6 * size), clipRight);
+
+  markDirty(first, y, last - first, 8 * size);
+
+  for (int16_t p = firstPage; p <= lastPage; p++) {
+    uint8_t shift = (p - page) * 8;
+    uint8_t rows = 0xFF;
+    uint8_t *dst = sBuffer + (p * targetWidth);
+
+    if (p == clipTop / 8)
+      rows &= 0xFF << (clipTop & 7);
+    if (p == (clipBottom - 1) / 8)
+      rows &= 0xFF >> (7 - ((clipBottom - 1) & 7));
+
+    for (int16_t col = first; col < last; col++) {
+      uint32_t column = columns[(col - x) / size];
+      uint32_t set = textColumnBits(column, setOnes, setZeros);
+      uint32_t clear = textColumnBits(column, clearOnes, clearZeros);
+      uint32_t flip = textColumnBits(column, flipOnes, flipZeros);
+
+      // move the column bits to those of the page
+      if (shift == 0) {
+        set <<= yOffset;
+        clear <<= yOffset;
+        flip <<= yOffset;
       }
-      line >>= 1;
+      else {
+        set >>= shift - yOffset;
+        clear >>= shift - yOffset;
+        flip >>= shift - yOffset;
+      }
+      dst[col] = ((dst[col] | ((uint8_t)set & rows)) &
+                  ~((uint8_t)clear & rows)) ^ ((uint8_t)flip & rows);
     }
   }
 }
@@ -1246,3 +3842,16 @@ void MicroGamer::clear()
     cursor_x = cursor_y = 0;
 }
 
+#if MICROGAMER_DISPLAY_LIST_SIZE
+void MicroGamer::drawDisplayListEntry(uint8_t op, const int16_t *args,
+                                      const uint8_t * const *pointers)
+{
+  if (op == DL_DRAW_CHAR) {
+    drawChar(args[0], args[1], args[2], args[3], args[4], args[5]);
+  }
+  else {
+    MicroGamerBase::drawDisplayListEntry(op, args, pointers);
+  }
+}
+#endif
+
@@ -10,7 +10,6 @@
 #include <Arduino.h>
 //#include <EEPROM.h>
 #include "MicroGamerCore.h"
-#include "Sprites.h"
 #include <Print.h>
 #include <limits.h>
 
@@ -82,8 +81,116 @@
  */
 #define INVERT 2
 
+// blit modes for drawSurface()
+#define BLIT_AND_NOT 0 /**< Blit mode clearing the pixels that are set in the surface. */
+#define BLIT_OR      1 /**< Blit mode setting the pixels that are set in the surface. */
+#define BLIT_XOR     2 /**< Blit mode inverting the pixels that are set in the surface. */
+#define BLIT_COPY    3 /**< Blit mode replacing the pixels with those of the surface. */
+
 #define CLEAR_BUFFER true /**< Value to be passed to `display()` to clear the screen buffer. */
 
+/** \brief
+ * The number of statically allocated display buffers, from 1 to 3.
+ *
+ * \details
+ * With 2 buffers, a frame can be drawn while the previous one is sent to the
+ * display. With 3, `display()` never has to wait for the display, as long as
+ * frame dropping is enabled.
+ *
+ * The default is 1. It must be changed with a compiler option, such as
+ * `-DMICROGAMER_FRAME_BUFFERS=2`, so that the library's own source files are
+ * built with the same value as the sketch. A `#define` in the sketch only
+ * reaches the sketch, leaving the library with buffers of a different size
+ * than the sketch expects.
+ *
+ * \see MicroGamerBase::display() MicroGamerBase::enableFrameDropping()
+ */
+#ifndef MICROGAMER_FRAME_BUFFERS
+#define MICROGAMER_FRAME_BUFFERS 1
+#endif
+
+#if MICROGAMER_FRAME_BUFFERS < 1 || MICROGAMER_FRAME_BUFFERS > 3
+#error "MICROGAMER_FRAME_BUFFERS must be 1, 2 or 3"
+#endif
+
+/** \brief
+ * The size in bytes of the display list used by the low RAM display mode.
+ *
+ * \details
+ * When this is defined to a value other than 0, there is no display buffer
+ * in RAM. Instead, the drawing functions record themselves in a display list
+ * of this size. `display()` then draws the whole list once for each page (8
+ * pixel high row) of the display, into a 128 byte stripe that is sent while
+ * the next page is drawn into a second stripe. Each draw call recorded uses
+ * between 5 and 25 bytes, depending on its parameters.
+ *
+ * The list holds everything drawn since the last `clear()`, so a sketch
+ * using this mode must clear the screen for each frame. In this mode:
+ *
+ * - `sBuffer` and `getBuffer()` only point to the page being drawn by
+ *   `display()`, so the buffer can't be accessed directly by a sketch.
+ * - `getPixel()` can't be used.
+ * - Double buffering, dirty region tracking and `MICROGAMER_FRAME_BUFFERS`
+ *   have no effect.
+ * - Arrays in RAM passed to the drawing functions, such as the points of
+ *   `fillPolygon()`, are used again by `display()` and must not change
+ *   before then.
+ *
+ * The default is 0. Like `MICROGAMER_FRAME_BUFFERS`, it must be set with a
+ * compiler option, such as `-DMICROGAMER_DISPLAY_LIST_SIZE=1024`, and not in
+ * the sketch.
+ *
+ * \see MicroGamerBase::displayListOverflow()
+ */
+#ifndef MICROGAMER_DISPLAY_LIST_SIZE
+#define MICROGAMER_DISPLAY_LIST_SIZE 0
+#endif
+
+#if MICROGAMER_DISPLAY_LIST_SIZE && MICROGAMER_FRAME_BUFFERS != 1
+#error "MICROGAMER_FRAME_BUFFERS must be 1 when MICROGAMER_DISPLAY_LIST_SIZE is used"
+#endif
+
+/** \brief
+ * The size in bytes of the cache of images decoded by `drawCompressed()`.
+ *
+ * \details
+ * When this is defined to a value other than 0, `drawCompressed()` decodes
+ * each compressed image, or frame of one, once into a RAM cache of this
+ * size. While it stays in the cache, it is drawn from there at the speed of
+ * the `Sprites` functions. An image `w` pixels wide and `h` pixels high uses
+ * `w * ((h + 7) / 8)` bytes. When there isn't enough room for a new image,
+ * the least recently drawn ones are removed. Images over 255 pixels wide or
+ * 248 pixels high, or larger than the cache, are always decoded.
+ *
+ * The cache holds at most `MICROGAMER_SPRITE_CACHE_ENTRIES` images, 16 by
+ * default.
+ *
+ * The default is 0. Like `MICROGAMER_FRAME_BUFFERS`, both values must be set
+ * with compiler options, such as `-DMICROGAMER_SPRITE_CACHE_SIZE=2048`, and
+ * not in the sketch.
+ *
+ * \see MicroGamerBase::spriteCacheHits() MicroGamerBase::spriteCacheMisses()
+ */
+#ifndef MICROGAMER_SPRITE_CACHE_SIZE
+#define MICROGAMER_SPRITE_CACHE_SIZE 0
+#endif
+
+#ifndef MICROGAMER_SPRITE_CACHE_ENTRIES
+#define MICROGAMER_SPRITE_CACHE_ENTRIES 16
+#endif
+
+#if MICROGAMER_SPRITE_CACHE_SIZE > 65535
+#error "MICROGAMER_SPRITE_CACHE_SIZE must be less than 65536"
+#endif
+
+// The number of display buffers there can be, including the one allocated by
+// enableDoubleBuffer() when there is only one static buffer.
+#if MICROGAMER_FRAME_BUFFERS < 2
+#define FRAME_BUFFERS_MAX 2
+#else
+#define FRAME_BUFFERS_MAX MICROGAMER_FRAME_BUFFERS
+#endif
+
 
 /** \brief
  * A rectangle object for collision functions.
@@ -116,6 +223,90 @@ struct Point
   int16_t y; /**< The Y coordinate of the point */
 };
 
+/** \brief
+ * The range of columns touched in each page of a display buffer.
+ *
+ * \details
+ * Used by dirty region tracking to record which parts of a display buffer
+ * have to be sent to the display or cleared. A page whose first column is
+ * greater than its last column is empty.
+ *
+ * (Not officially part of the API)
+ *
+ * \see MicroGamerBase::enableDirtyTracking()
+ */
+struct PageSpans
+{
+  uint8_t first[HEIGHT/8]; /**< The leftmost column touched in each page */
+  uint8_t last[HEIGHT/8];  /**< The rightmost column touched in each page */
+};
+
+/** \brief
+ * An offscreen image that can be drawn on like the display buffer.
+ *
+ * \details
+ * The image is held in a buffer provided by the sketch, laid out in the
+ * same way as the display buffer: `pages` rows of `width` bytes, each byte
+ * holding 8 vertical pixels with the top one in the least significant bit.
+ * The buffer must be `width * pages` bytes.
+ *
+ * Example:
+ *
+ * \code
+ * uint8_t hudPixels[128 * 2];
+ * Surface hud = { hudPixels, 128, 2 }; // 128 x 16 pixels
+ * \endcode
+ *
+ * \see MicroGamerBase::setRenderTarget() MicroGamerBase::drawSurface()
+ */
+struct Surface
+{
+  uint8_t *buffer; /**< The image, `pages` rows of `width` bytes */
+  uint8_t width;   /**< The width of the image in pixels */
+  uint8_t pages;   /**< The height of the image in pages of 8 pixels */
+};
+
+/** \brief
+ * A map of tiles from a tileset, drawn with `MicroGamerBase::drawTilemap()`.
+ *
+ * \details
+ * The tileset is an array in the format used by `Sprites`: the width and
+ * height of the tiles, then the image of each tile. Tiles are drawn as
+ * whole pages, so their height should be a multiple of 8.
+ *
+ * The map is an array of `width * height` tile numbers, row by row. It can
+ * be in program memory or in RAM, to be changed as the game goes on.
+ *
+ * Tiles can be animated with a frame table, an array with a byte for each
+ * tile of the tileset. A tile used in the map whose byte is 2 or more is the
+ * first frame of an animation of that many frames, which are the tiles
+ * following it in the tileset. The frame drawn is chosen by the frame
+ * number passed to `drawTilemap()`. Set the table to NULL if no tiles are
+ * animated.
+ *
+ * Example:
+ *
+ * \code
+ * // tiles 0 to 2 are still, tile 3 is water animated with tiles 4 and 5
+ * const uint8_t PROGMEM frames[] = { 1, 1, 1, 3, 1, 1 };
+ * const uint8_t PROGMEM level[] = {
+ *   1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+ *   // ...
+ * };
+ * Tilemap levelMap = { tiles, level, 20, 12, frames };
+ * \endcode
+ *
+ * \see MicroGamerBase::drawTilemap()
+ */
+struct Tilemap
+{
+  const uint8_t *tileset;   /**< The tiles, in the Sprites format */
+  const uint8_t *map;       /**< The tile numbers, `width` by `height` */
+  uint8_t width;            /**< The width of the map in tiles */
+  uint8_t height;           /**< The height of the map in tiles */
+  const uint8_t *frames;    /**< The frame table, or NULL */
+};
+
 //====================================
 //========== MicroGamerBase ==========
 //====================================
@@ -162,6 +353,8 @@ struct Point
 class MicroGamerBase : public MicroGamerCore
 {
  friend class MicroGamerEx;
+ friend class Sprites;
+ friend class MicroGamerConsole;
 
  public:
   MicroGamerBase();
@@ -339,9 +532,14 @@ class MicroGamerBase : public MicroGamerCore
    * Clear the display buffer.
    *
    * \details
-   * The entire contents of the screen buffer are cleared to BLACK.
+   * The entire contents of the screen buffer are cleared to BLACK. The clip
+   * rectangle doesn't limit the clear; use `fillScreen()` to clear only the
+   * clip rectangle.
+   *
+   * When dirty region tracking is enabled, only the parts of the buffer
+   * drawn on since the previous clear are actually written.
    *
-   * \see display(bool)
+   * \see display(bool) enableDirtyTracking()
    */
   void clear();
 
@@ -358,7 +556,15 @@ class MicroGamerBase : public MicroGamerCore
    * transfer is complete before drawing a new frame, or enable double
    * buffering.
    *
+   * With more than one display buffer, the frame is handed over to be sent
+   * and `sBuffer` is switched to a buffer that isn't needed by the display
+   * transfers. If the previous frame hasn't started being sent yet, this
+   * frame is queued behind it, or replaces it when frame dropping is
+   * enabled. Drawing can then start on the new buffer right away. Its
+   * contents are those of an earlier frame.
+   *
    * \see display(bool) waitDisplayUpdate() enableDoubleBuffer()
+   * MICROGAMER_FRAME_BUFFERS busWaitLoad()
    */
   void display();
 
@@ -398,7 +604,10 @@ class MicroGamerBase : public MicroGamerCore
    * provide higher frame rate, but it also takes an extra 1K of RAM to allocate
    * the extra buffer.
    *
-   * \see display()
+   * When `MICROGAMER_FRAME_BUFFERS` is more than 1, the buffers are already
+   * allocated statically and this function does nothing.
+   *
+   * \see display() MICROGAMER_FRAME_BUFFERS
    */
   void enableDoubleBuffer();
 
@@ -409,6 +618,313 @@ class MicroGamerBase : public MicroGamerCore
    */
   bool doubleBuffer();
 
+  /** \brief
+   * Enable frame dropping
+   *
+   * \details
+   * When a frame is displayed while the previous one is still waiting to be
+   * sent, the previous one is dropped and only the latest frame is sent. With
+   * 3 display buffers, `display()` then never waits for the display.
+   *
+   * Without frame dropping, every frame is sent and `display()` waits for a
+   * buffer to be free.
+   *
+   * \see frameDropping() framesDropped() MICROGAMER_FRAME_BUFFERS
+   */
+  void enableFrameDropping();
+
+  /** \brief
+   * Returns the state of the frame dropping feature.
+   *
+   * \return True if frame dropping is enabled.
+   */
+  bool frameDropping();
+
+  /** \brief
+   * Get the number of frames dropped.
+   *
+   * \return The number of frames that were replaced by a newer frame before
+   * being sent to the display.
+   *
+   * \see enableFrameDropping()
+   */
+  unsigned long framesDropped();
+
+  /** \brief
+   * Enable dirty region tracking
+   *
+   * \details
+   * The drawing functions of the library record, for each page (8 pixel high
+   * row) of the display buffer, the range of columns they have modified. When
+   * dirty region tracking is enabled, `display()` only sends the parts of the
+   * buffer that changed since the previous frame, which takes less time than
+   * sending the full 1024 bytes. Consecutive pages are grouped into a single
+   * area when sending the extra columns is cheaper than setting up another
+   * area.
+   *
+   * The same information is used by `clear()`, which then only clears the
+   * parts of the buffer that were drawn on since the previous `clear()`.
+   *
+   * \note
+   * Changes made by writing to `sBuffer` directly aren't seen by the
+   * tracking. A sketch doing so must call `markDirty()` for the modified area.
+   *
+   * \see dirtyTracking() markDirty() display() clear() displayBytesSaved()
+   */
+  void enableDirtyTracking();
+
+  /** \brief
+   * Returns the state of the dirty region tracking feature.
+   *
+   * \return True if dirty region tracking is enabled.
+   */
+  bool dirtyTracking();
+
+  /** \brief
+   * Mark an area of the display buffer as modified.
+   *
+   * \param x The X coordinate of the left edge.
+   * \param y The Y coordinate of the top edge.
+   * \param w The width of the area.
+   * \param h The height of the area.
+   *
+   * \details
+   * The area will be sent to the display by the next `display()` when dirty
+   * region tracking is enabled. The library drawing functions call this
+   * themselves, so it's only needed after writing to `sBuffer` directly.
+   *
+   * \see enableDirtyTracking()
+   */
+  static void markDirty(int16_t x, int16_t y, int16_t w, int16_t h);
+
+  /** \brief
+   * Get the number of bytes of the display buffer sent by the last
+   * `display()`.
+   *
+   * \return The number of display buffer bytes sent by the last `display()`.
+   *
+   * \see displayBytesSaved() enableDirtyTracking()
+   */
+  uint16_t lastDisplayBytes();
+
+  /** \brief
+   * Get the number of display buffer bytes that didn't have to be sent.
+   *
+   * \return The total number of display buffer bytes that dirty region
+   * tracking avoided sending since the start of the sketch.
+   *
+   * \see lastDisplayBytes() enableDirtyTracking()
+   */
+  unsigned long displayBytesSaved();
+
+  /** \brief
+   * Test if the display list is full.
+   *
+   * \return True if draw calls were ignored since the last `clear()` because
+   * the display list was full. Always false when the low RAM display mode
+   * isn't used.
+   *
+   * \see MICROGAMER_DISPLAY_LIST_SIZE
+   */
+  bool displayListOverflow();
+
+  /** \brief
+   * Get the number of compressed images drawn from the sprite cache.
+   *
+   * \return The number of times `drawCompressed()` found the image in the
+   * cache since the start of the sketch or the last `clearSpriteCache()`.
+   * Always 0 when the cache isn't used.
+   *
+   * \see spriteCacheMisses() MICROGAMER_SPRITE_CACHE_SIZE
+   */
+  unsigned long spriteCacheHits();
+
+  /** \brief
+   * Get the number of compressed images decoded by `drawCompressed()`.
+   *
+   * \return The number of times `drawCompressed()` had to decode an image
+   * since the start of the sketch or the last `clearSpriteCache()`. Always 0
+   * when the cache isn't used.
+   *
+   * \details
+   * Misses after the first use of each image mean that the cache is too
+   * small for the images drawn in a frame.
+   *
+   * \see spriteCacheHits() MICROGAMER_SPRITE_CACHE_SIZE
+   */
+  unsigned long spriteCacheMisses();
+
+  /** \brief
+   * Empty the sprite cache and reset its hit and miss counts.
+   *
+   * \see spriteCacheHits() spriteCacheMisses() MICROGAMER_SPRITE_CACHE_SIZE
+   */
+  void clearSpriteCache();
+
+  /** \brief
+   * Move the image in the display buffer by a number of pixels.
+   *
+   * \param dx The number of columns to move the image right by, or left by
+   *           if it's negative.
+   * \param dy The number of rows to move the image down by, or up by if it's
+   *           negative.
+   * \param fill The color of the pixels that move into view, BLACK (the
+   *             default) or WHITE.
+   * \param exposed An array of 2 rectangles set to the areas that moved into
+   *                view (optional).
+   *
+   * \return The number of rectangles set in `exposed`, from 0 to 2.
+   *
+   * \details
+   * The pixels moved out of the buffer are lost, and the areas they leave
+   * are filled with the fill color. Only those areas then have to be drawn
+   * to complete the new frame. There's one area for each direction moved:
+   * a strip across the whole width for the vertical move, and a strip
+   * beside it for the horizontal one.
+   *
+   * Vertical moves shift the bits of 4 columns at a time across the page
+   * boundaries. Horizontal moves are a `memmove()` of each page.
+   *
+   * It moves the render target instead when a surface is set. With a clip
+   * rectangle set, only the image in the clip rectangle moves, and the
+   * areas are given in drawing coordinates. In the low RAM display mode,
+   * there's no complete display buffer to move, so it only moves surfaces.
+   *
+   * When `MICROGAMER_FRAME_BUFFERS` is more than 1, the buffer drawn to holds
+   * an older frame than the last one displayed, so it has to be moved by the
+   * total of the moves since that frame.
+   *
+   * Example:
+   *
+   * \code
+   * Rect exposed[2];
+   * uint8_t count = mg.scroll(-2, 0, BLACK, exposed);
+   * for (uint8_t i = 0; i < count; i++) {
+   *   drawTerrain(exposed[i]);
+   * }
+   * \endcode
+   *
+   * \see scrollRect() scrollVertical()
+   */
+  static uint8_t scroll(int16_t dx, int16_t dy, uint8_t fill = BLACK, Rect *exposed = NULL);
+
+  /** \brief
+   * Move the image in an area of the display buffer by a number of pixels.
+   *
+   * \param x The X coordinate of the left edge of the area.
+   * \param y The Y coordinate of the top edge of the area.
+   * \param w The width of the area.
+   * \param h The height of the area.
+   * \param dx The number of columns to move the image right by, or left by
+   *           if it's negative.
+   * \param dy The number of rows to move the image down by, or up by if it's
+   *           negative.
+   * \param fill The color of the pixels that move into view, BLACK (the
+   *             default) or WHITE.
+   * \param exposed An array of 2 rectangles set to the areas that moved into
+   *                view (optional).
+   *
+   * \return The number of rectangles set in `exposed`, from 0 to 2.
+   *
+   * \details
+   * This works like `scroll()`, but only the pixels inside the area are
+   * moved, and those moved out of the area are lost. The rest of the buffer
+   * isn't changed. The area is limited to the clip rectangle.
+   *
+   * \see scroll()
+   */
+  static uint8_t scrollRect(int16_t x, int16_t y, uint8_t w, uint8_t h, int16_t dx, int16_t dy, uint8_t fill = BLACK, Rect *exposed = NULL);
+
+  /** \brief
+   * Scroll the display vertically using the display start line.
+   *
+   * \param dy The number of rows to scroll by. A positive value moves the
+   * image up, showing `dy` new rows at the bottom of the display. A negative
+   * value moves it down, showing new rows at the top.
+   *
+   * \details
+   * The display shows the display buffer starting at a row that is moved by
+   * this function, wrapping around at the end of the buffer. Nothing is moved
+   * in the buffer, so only the rows that scrolled into view have to be drawn
+   * and, with dirty region tracking enabled, sent to the display. They have
+   * to be drawn at the buffer rows given by `bufferY()`, which are the rows
+   * that scrolled out of view. A sketch scrolling this way doesn't clear the
+   * buffer for each frame. This is best used with a single frame buffer,
+   * since the other buffers would each need their own copy of the image.
+   *
+   * The new start line is sent to the display by the next `display()`,
+   * together with the new rows. It only moves the image once that frame
+   * starts being sent, so a frame still being sent isn't moved.
+   *
+   * \note
+   * The direction of the scrolling is reversed when the display is flipped
+   * vertically.
+   *
+   * \see scrollY() bufferY() setShake() enableDirtyTracking()
+   */
+  static void scrollVertical(int8_t dy);
+
+  /** \brief
+   * Get the buffer row shown at the top of the display.
+   *
+   * \return The row of the display buffer, from 0 to 63, shown on the top row
+   * of the display.
+   *
+   * \see scrollVertical() bufferY()
+   */
+  static uint8_t scrollY();
+
+  /** \brief
+   * Get the display buffer row shown on a row of the display.
+   *
+   * \param y The row of the display, which can be outside of it.
+   *
+   * \return The row of the display buffer, from 0 to 63, shown on display
+   * row `y` once the scroll set by `scrollVertical()` is sent.
+   *
+   * \details
+   * For example, after `scrollVertical(4)` the 4 rows that scrolled into
+   * view are drawn at buffer rows `bufferY(HEIGHT - 4)` to
+   * `bufferY(HEIGHT - 1)`. The rows wrap around from 63 to 0, so an area
+   * crossing that point has to be drawn in two parts.
+   *
+   * \see scrollVertical()
+   */
+  static int16_t bufferY(int16_t y);
+
+  /** \brief
+   * Move the whole image vertically for a screen shake effect.
+   *
+   * \param dy The number of rows the image is moved up, or down if it's
+   * negative. 0 sets the image back to its normal position.
+   *
+   * \details
+   * The image is moved by the display using its display offset, wrapping
+   * around at the edges, without redrawing or sending the buffer. The offset
+   * is sent right away and doesn't change the rows used by
+   * `scrollVertical()`.
+   *
+   * \see scrollVertical()
+   */
+  static void setShake(int8_t dy);
+
+  /** \brief
+   * Send pages to the display with the next frame even if they didn't
+   * change.
+   *
+   * \param firstPage The first page (8 pixel high row) to send.
+   * \param lastPage The last page to send.
+   *
+   * \details
+   * This is needed when the content of the display RAM was changed by
+   * something else than `display()`, such as after stopping a horizontal
+   * scroll. It has no effect when dirty region tracking isn't enabled since
+   * every frame is then sent entirely.
+   *
+   * \see MicroGamerCore::stopHorizontalScroll() enableDirtyTracking()
+   */
+  static void resendPages(uint8_t firstPage, uint8_t lastPage);
+
   /** \brief
    * Set a single pixel in the display buffer to the specified color.
    *
@@ -429,7 +945,12 @@ class MicroGamerBase : public MicroGamerCore
    * \param x The X coordinate of the pixel.
    * \param y The Y coordinate of the pixel.
    *
-   * \return WHITE if the pixel is on or BLACK if the pixel is off.
+   * \return WHITE if the pixel is on or BLACK if the pixel is off. Pixels
+   * outside the display are BLACK.
+   *
+   * \details
+   * The coordinates are moved by the origin set with `setOrigin()`. Pixels
+   * outside of the clip rectangle can be read.
    */
   uint8_t getPixel(uint8_t x, uint8_t y);
 
@@ -457,11 +978,73 @@ class MicroGamerBase : public MicroGamerCore
    */
   void fillCircle(int16_t x0, int16_t y0, uint8_t r, uint8_t color = WHITE);
 
+  /** \brief
+   * Draw a filled-in circle of a given radius with a dither pattern.
+   *
+   * \param x0 The X coordinate of the circle's center.
+   * \param y0 The Y coordinate of the circle's center.
+   * \param r The radius of the circle in pixels.
+   * \param pattern The pattern, as described for `ditherPattern()`.
+   * \param color The color of the pixels set in the pattern.
+   *
+   * \see ditherPattern()
+   */
+  void fillCircle(int16_t x0, int16_t y0, uint8_t r, const uint8_t *pattern, uint8_t color);
+
   // Draw one or both vertical halves of a filled-in circle or
   // rounded rectangle edge.
   // (Not officially part of the API)
   void fillCircleHelper(int16_t x0, int16_t y0, uint8_t r, uint8_t sides, int16_t delta, uint8_t color = WHITE);
 
+  /** \brief
+   * Draw an ellipse with the given horizontal and vertical radii.
+   *
+   * \param x0 The X coordinate of the ellipse's center.
+   * \param y0 The Y coordinate of the ellipse's center.
+   * \param rx The horizontal radius of the ellipse in pixels.
+   * \param ry The vertical radius of the ellipse in pixels.
+   * \param color The ellipse's color (optional; defaults to WHITE).
+   *
+   * \details
+   * With equal radii, the same pixels are drawn as by `drawCircle()`.
+   *
+   * \see fillEllipse() drawCircle()
+   */
+  void drawEllipse(int16_t x0, int16_t y0, uint8_t rx, uint8_t ry, uint8_t color = WHITE);
+
+  /** \brief
+   * Draw a filled-in ellipse with the given horizontal and vertical radii.
+   *
+   * \param x0 The X coordinate of the ellipse's center.
+   * \param y0 The Y coordinate of the ellipse's center.
+   * \param rx The horizontal radius of the ellipse in pixels.
+   * \param ry The vertical radius of the ellipse in pixels.
+   * \param color The ellipse's color (optional; defaults to WHITE).
+   *
+   * \see drawEllipse() fillCircle()
+   */
+  void fillEllipse(int16_t x0, int16_t y0, uint8_t rx, uint8_t ry, uint8_t color = WHITE);
+
+  /** \brief
+   * Draw part of the outline of a circle.
+   *
+   * \param x0 The X coordinate of the circle's center.
+   * \param y0 The Y coordinate of the circle's center.
+   * \param r The radius of the circle in pixels.
+   * \param startAngle The angle where the arc starts, in degrees.
+   * \param endAngle The angle where the arc ends, in degrees.
+   * \param color The arc's color (optional; defaults to WHITE).
+   *
+   * \details
+   * The angles are measured clockwise from the right of the center, so 90
+   * is straight down. The arc goes clockwise from `startAngle` to
+   * `endAngle`, and is a full circle when they are 360 or more degrees
+   * apart. The pixels drawn are those of `drawCircle()` that are in the arc.
+   *
+   * \see drawCircle()
+   */
+  void drawArc(int16_t x0, int16_t y0, uint8_t r, int16_t startAngle, int16_t endAngle, uint8_t color = WHITE);
+
   /** \brief
    * Draw a line between two specified points.
    *
@@ -473,9 +1056,49 @@ class MicroGamerBase : public MicroGamerCore
    * Draw a line from the start point to the end point using
    * Bresenham's algorithm.
    * The start and end points can be at any location with respect to the other.
+   *
+   * The part of the line off the screen is clipped off before the line is
+   * drawn, and the pixels in the same row or column are drawn together, a
+   * byte at a time.
+   *
+   * \see drawPolyline() drawLines()
    */
   void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t color = WHITE);
 
+  /** \brief
+   * Draw connected lines through an array of points.
+   *
+   * \param points An array of the points, in the order they are joined.
+   * \param count The number of points in the array.
+   * \param color The color of the lines (optional; defaults to WHITE).
+   *
+   * \details
+   * A line is drawn from each point to the next, with the same pixels as
+   * `drawLine()`. To draw a closed shape, the last point has to be the same
+   * as the first. The pixel of a point shared by two lines, including the
+   * first point of a closed shape, is only drawn once, so the lines can be
+   * drawn with INVERSE.
+   *
+   * \see drawLine() drawLines()
+   */
+  void drawPolyline(const Point *points, uint8_t count, uint8_t color = WHITE);
+
+  /** \brief
+   * Draw a number of separate lines.
+   *
+   * \param points An array of the points at the ends of the lines, two for
+   *               each line.
+   * \param count The number of lines.
+   * \param color The color of the lines (optional; defaults to WHITE).
+   *
+   * \details
+   * This is the same as calling `drawLine()` for each pair of points, but
+   * it's a single call, recorded once in the low RAM display mode.
+   *
+   * \see drawLine() drawPolyline()
+   */
+  void drawLines(const Point *points, uint8_t count, uint8_t color = WHITE);
+
   /** \brief
    * Draw a rectangle of a specified width and height.
    *
@@ -518,13 +1141,81 @@ class MicroGamerBase : public MicroGamerCore
    */
   void fillRect(int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t color = WHITE);
 
+  /** \brief
+   * Draw a filled-in rectangle with a dither pattern.
+   *
+   * \param x The X coordinate of the upper left corner.
+   * \param y The Y coordinate of the upper left corner.
+   * \param w The width of the rectangle.
+   * \param h The height of the rectangle.
+   * \param pattern The pattern, as described for `ditherPattern()`.
+   * \param color The color of the pixels set in the pattern.
+   *
+   * \see ditherPattern()
+   */
+  void fillRect(int16_t x, int16_t y, uint8_t w, uint8_t h, const uint8_t *pattern, uint8_t color);
+
   /** \brief
    * Fill the screen buffer with the specified color.
    *
    * \param color The fill color (optional; defaults to WHITE).
+   *
+   * \details
+   * With INVERSE, all the pixels are inverted. Only the pixels in the clip
+   * rectangle are filled.
+   *
+   * \see setClipRect()
    */
   void fillScreen(uint8_t color = WHITE);
 
+  /** \brief
+   * Fill the screen buffer with a dither pattern.
+   *
+   * \param pattern The pattern, as described for `ditherPattern()`.
+   * \param color The color of the pixels set in the pattern.
+   *
+   * \details
+   * Only the pixels set in the pattern are changed.
+   *
+   * \see ditherPattern()
+   */
+  void fillScreen(const uint8_t *pattern, uint8_t color);
+
+  /** \brief
+   * Get an ordered dither pattern for a level of gray.
+   *
+   * \param level The level, from 0 for no pixels set to 16 for all of them.
+   *               Higher levels are the same as 16.
+   *
+   * \return The pattern, an array of 8 bytes in program memory.
+   *
+   * \details
+   * A pattern is 8 bytes, the same as 8 columns of a page of the screen
+   * buffer. Each byte has the pixels of a column, with the top pixel in the
+   * least significant bit. The pattern fill functions draw a pixel in the
+   * given color where its bit in the pattern is set, and leave the other
+   * pixels as they are.
+   *
+   * Patterns are lined up with the screen, not with the shape being filled,
+   * so shapes filled with the same pattern next to each other join up without
+   * a seam. Each pixel is masked by the byte for its column modulo 8 and the
+   * bit for its row modulo 8.
+   *
+   * These patterns are made from a 4x4 Bayer matrix, which gives 17 evenly
+   * spread levels. Any other 8 byte array can be used as a pattern. In the
+   * low RAM display mode, a pattern in RAM must not change until the frame
+   * has been displayed.
+   *
+   * Example:
+   *
+   * \code
+   * // a half lit circle over a rectangle of a quarter lit pixels
+   * mg.fillRect(0, 32, 128, 32, MicroGamer::ditherPattern(4), WHITE);
+   * mg.fillCircle(64, 32, 20, MicroGamer::ditherPattern(8), WHITE);
+   * \endcode
+   */
+  static const uint8_t *ditherPattern(uint8_t level);
+
   /** \brief
    * Draw a rectangle with rounded corners.
    *
@@ -549,6 +1240,21 @@ class MicroGamerBase : public MicroGamerCore
    */
   void fillRoundRect(int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t r, uint8_t color = WHITE);
 
+  /** \brief
+   * Draw a filled-in rectangle with rounded corners with a dither pattern.
+   *
+   * \param x The X coordinate of the left edge.
+   * \param y The Y coordinate of the top edge.
+   * \param w The width of the rectangle.
+   * \param h The height of the rectangle.
+   * \param r The radius of the semicircles forming the corners.
+   * \param pattern The pattern, as described for `ditherPattern()`.
+   * \param color The color of the pixels set in the pattern.
+   *
+   * \see ditherPattern()
+   */
+  void fillRoundRect(int16_t x, int16_t y, uint8_t w, uint8_t h, uint8_t r, const uint8_t *pattern, uint8_t color);
+
   /** \brief
    * Draw a triangle given the coordinates of each corner.
    *
@@ -575,6 +1281,40 @@ class MicroGamerBase : public MicroGamerCore
    */
   void fillTriangle (int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint8_t color = WHITE);
 
+  /** \brief
+   * Draw a filled-in triangle with a dither pattern.
+   *
+   * \param x0,x1,x2 The X coordinates of the corners.
+   * \param y0,y1,y2 The Y coordinates of the corners.
+   * \param pattern The pattern, as described for `ditherPattern()`.
+   * \param color The color of the pixels set in the pattern.
+   *
+   * \details
+   * Triangles sharing an edge fit together in the same way as with
+   * `fillTriangle()`, and so does the pattern.
+   *
+   * \see ditherPattern()
+   */
+  void fillTriangle (int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, const uint8_t *pattern, uint8_t color);
+
+  /** \brief
+   * Draw a filled-in convex polygon given the coordinates of its corners.
+   *
+   * \param points An array of the corners, in order round the polygon in
+   *               either direction.
+   * \param count The number of corners in the array.
+   * \param color The polygon's color (optional; defaults to WHITE).
+   *
+   * \details
+   * The polygon must be convex: every row of pixels crosses it at most
+   * once. The rows are filled between its edges in the same way as by
+   * `fillTriangle()`, so polygons sharing corners fit together the way
+   * triangles do.
+   *
+   * \see fillTriangle()
+   */
+  void fillPolygon(const Point *points, uint8_t count, uint8_t color = WHITE);
+
   /** \brief
    * Draw a bitmap from an array in program memory.
    *
@@ -624,7 +1364,11 @@ class MicroGamerBase : public MicroGamerCore
    * This function requires a lot of additional CPU power and will draw images
    * slower than `drawBitmap()`, which uses bitmaps that are stored in a format
    * that allows them to be directly written to the screen. It is recommended
-   * you use `drawBitmap()` when possible.
+   * you use `drawBitmap()` when possible. The `XYBitmap` template, in
+   * MicroGamerBitmaps.h, converts an array in this format for `drawBitmap()`
+   * when the sketch is compiled.
+   *
+   * \see XYBitmap
    */
   void drawSlowXYBitmap(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t w, uint8_t h, uint8_t color = WHITE);
 
@@ -636,6 +1380,8 @@ class MicroGamerBase : public MicroGamerCore
    * \param bitmap A pointer to the compressed bitmap array in program memory.
    * \param color The color of pixels for bits set to 1 in the bitmap.
    *              (optional; defaults to WHITE).
+   * \param frame The frame number of the bitmap to draw
+   *              (optional; defaults to 0).
    *
    * \details
    * Draw a bitmap starting at the given coordinates from an array that has
@@ -648,9 +1394,16 @@ class MicroGamerBase : public MicroGamerCore
    * pixel set to the specified color. For bits set to 0 in the array, the
    * corresponding pixel will be left unchanged.
    *
+   * The array can hold several frames, each one a complete compressed bitmap
+   * following the previous one. The frames before the one drawn are skipped
+   * span by span, so later frames take a little longer to find.
+   *
+   * When `MICROGAMER_SPRITE_CACHE_SIZE` is defined, decoded images are kept
+   * in a RAM cache and drawn from there the next time.
+   *
    * The array must be located in program memory by using the PROGMEM modifier.
    */
-  static void drawCompressed(int16_t sx, int16_t sy, const uint8_t *bitmap, uint8_t color = WHITE);
+  static void drawCompressed(int16_t sx, int16_t sy, const uint8_t *bitmap, uint8_t color = WHITE, uint8_t frame = 0);
 
   /** \brief
    * Get a pointer to the display buffer in RAM.
@@ -671,6 +1424,205 @@ class MicroGamerBase : public MicroGamerCore
    */
   uint8_t* getBuffer();
 
+  /** \brief
+   * Draw on a surface instead of the display buffer.
+   *
+   * \param surface The surface to draw on, or NULL to draw on the display
+   *                buffer again.
+   *
+   * \details
+   * Until the render target is set back to NULL, all the drawing functions,
+   * including text and `Sprites`, draw on the surface, clipped to its size.
+   * `clear()` clears the surface, and `sBuffer` and `getBuffer()` point to
+   * its buffer.
+   *
+   * Drawing on a surface is done right away, also in the low RAM display
+   * mode, and isn't tracked as dirty regions of the display. A surface drawn
+   * once can then be drawn on the display each frame with `drawSurface()`,
+   * which is much quicker than drawing its contents again.
+   *
+   * The render target must be set back to NULL before `display()`.
+   *
+   * Example:
+   *
+   * \code
+   * mg.setRenderTarget(&hud);
+   * mg.clear();
+   * mg.print(F("SCORE"));
+   * mg.drawRect(0, 0, 128, 16);
+   * mg.setRenderTarget(NULL);
+   * \endcode
+   *
+   * \see getRenderTarget() drawSurface() Surface
+   */
+  static void setRenderTarget(Surface *surface);
+
+  /** \brief
+   * Get the surface being drawn on.
+   *
+   * \return The surface set by `setRenderTarget()`, or NULL when drawing on
+   *         the display buffer.
+   *
+   * \see setRenderTarget()
+   */
+  static Surface *getRenderTarget();
+
+  /** \brief
+   * Limit drawing to a rectangle of the render target.
+   *
+   * \param x The X coordinate of the left edge of the rectangle.
+   * \param y The Y coordinate of the top edge of the rectangle.
+   * \param w The width of the rectangle.
+   * \param h The height of the rectangle.
+   *
+   * \details
+   * All the drawing functions, including text, `Sprites`, `drawCompressed()`,
+   * `fillScreen()` and `scroll()`, only change the pixels inside the clip
+   * rectangle. A call drawing entirely outside of it returns before doing
+   * any work. `clear()` still clears the whole render target.
+   *
+   * The rectangle is given in the coordinates of the render target, not
+   * moved by the origin set with `setOrigin()`, and only the part of it on
+   * the target is used. Setting the render target clears the clip rectangle
+   * and the origin.
+   *
+   * In the low RAM display mode, the clip rectangle is recorded in the
+   * display list, so it applies to the calls drawn after it as it does when
+   * drawing on a display buffer.
+   *
+   * \see clearClipRect() getClipRect() setViewport() setOrigin()
+   */
+  static void setClipRect(int16_t x, int16_t y, int16_t w, int16_t h);
+
+  /** \brief
+   * Allow drawing on the whole render target again.
+   *
+   * \see setClipRect()
+   */
+  static void clearClipRect();
+
+  /** \brief
+   * Get the area drawing is limited to.
+   *
+   * \return The part of the clip rectangle on the render target, in the
+   *         coordinates of the target. Its height is limited to 255.
+   *
+   * \see setClipRect()
+   */
+  static Rect getClipRect();
+
+  /** \brief
+   * Move the drawing coordinates.
+   *
+   * \param x The X coordinate on the render target of drawing coordinate 0.
+   * \param y The Y coordinate on the render target of drawing coordinate 0.
+   *
+   * \details
+   * The coordinates given to all the drawing functions, including text,
+   * `Sprites`, `drawTilemap()`, `scrollRect()` and `getPixel()`, are moved by
+   * the origin. Together with `setClipRect()`, this lets the same code draw
+   * into different parts of the screen, such as the two halves of a split
+   * screen game. The text cursor isn't moved, so text printed after the
+   * origin changes starts at the cursor in the new coordinates.
+   *
+   * \see getOrigin() setViewport()
+   */
+  static void setOrigin(int16_t x, int16_t y);
+
+  /** \brief
+   * Get the origin of the drawing coordinates.
+   *
+   * \return The point of the render target where the drawing coordinates
+   *         are (0, 0).
+   *
+   * \see setOrigin()
+   */
+  static Point getOrigin();
+
+  /** \brief
+   * Draw in a rectangle of the render target as if it was the whole target.
+   *
+   * \param x The X coordinate of the left edge of the rectangle.
+   * \param y The Y coordinate of the top edge of the rectangle.
+   * \param w The width of the rectangle.
+   * \param h The height of the rectangle.
+   *
+   * \details
+   * This sets the clip rectangle to the given one and the origin to its top
+   * left corner.
+   *
+   * Example:
+   *
+   * \code
+   * // the left half of the screen for player 1, the right half for player 2
+   * mg.setViewport(0, 0, 63, 64);
+   * drawWorld(player1);
+   * mg.setViewport(65, 0, 63, 64);
+   * drawWorld(player2);
+   * mg.setViewport(0, 0, WIDTH, HEIGHT);
+   * \endcode
+   *
+   * \see setClipRect() setOrigin()
+   */
+  static void setViewport(int16_t x, int16_t y, int16_t w, int16_t h);
+
+  /** \brief
+   * Draw a surface on the render target.
+   *
+   * \param x The X coordinate of the left edge of the surface.
+   * \param y The Y coordinate of the top edge of the surface.
+   * \param surface The surface to draw.
+   * \param mode `BLIT_COPY` (the default) to replace the pixels under the
+   *             surface, or `BLIT_OR`, `BLIT_AND_NOT` or `BLIT_XOR` to set,
+   *             clear or invert the pixels that are set in the surface.
+   *
+   * \details
+   * The surface is drawn on the display buffer, or on another surface set
+   * with `setRenderTarget()`, 4 bytes at a time wherever it can be. It's
+   * quickest when `y` is a multiple of 8, so that its pages line up with
+   * those of the target.
+   *
+   * A surface can't be drawn on itself. In the low RAM display mode, the
+   * surface and its contents must not change until the frame has been
+   * displayed.
+   *
+   * \see setRenderTarget() Surface
+   */
+  static void drawSurface(int16_t x, int16_t y, const Surface *surface, uint8_t mode = BLIT_COPY);
+
+  /** \brief
+   * Draw the part of a tilemap seen by a camera, covering the screen.
+   *
+   * \param tilemap The tilemap to draw.
+   * \param cameraX The X coordinate in the map, in pixels, of the left
+   *                edge of the screen.
+   * \param cameraY The Y coordinate in the map, in pixels, of the top edge
+   *                of the screen.
+   * \param frame The frame number of the animated tiles (optional; defaults
+   *              to 0). It's usually a count of game frames or ticks.
+   *
+   * \details
+   * All the pixels of the screen are drawn, with the pixels outside the map
+   * drawn BLACK, so the screen doesn't have to be cleared first. The tiles
+   * are copied straight into the display buffer a page row at a time, each
+   * tile being looked up once per page row. With `cameraY` a multiple of 8
+   * the tile bytes are copied as they are, otherwise the bytes of the two
+   * tile rows over each page are shifted and merged. Any other drawing is
+   * done over the tilemap after it.
+   *
+   * With a clip rectangle set, only the clip rectangle is covered, and the
+   * camera coordinates are those of the origin set with `setOrigin()`.
+   * `setViewport()` makes a tilemap fill a part of the screen, seen from
+   * the top left corner of it.
+   *
+   * It's drawn on a surface instead when one is the render target. In the
+   * low RAM display mode, the tilemap and its arrays must not change until
+   * the frame has been displayed.
+   *
+   * \see Tilemap
+   */
+  static void drawTilemap(const Tilemap *tilemap, int16_t cameraX, int16_t cameraY, uint8_t frame = 0);
+
   /** \brief
    * Seed the random number generator with a random value.
    *
@@ -806,10 +1758,26 @@ class MicroGamerBase : public MicroGamerCore
    * that the frame rate should be made slower or the frame processing code
    * should be optimized to run faster.
    *
-   * \see setFrameRate() nextFrame()
+   * \see setFrameRate() nextFrame() busWaitLoad()
    */
   int cpuLoad();
 
+  /** \brief
+   * Return the time spent waiting for the display as a percentage.
+   *
+   * \return The time spent waiting for the display transfers during the
+   * last frame, as a percentage of the total frame time.
+   *
+   * \details
+   * This is the time spent in `display()` and `waitDisplayUpdate()` waiting
+   * for a display buffer to be free. It's included in the load returned by
+   * `cpuLoad()`. Enabling double buffering or more display buffers can reduce
+   * it.
+   *
+   * \see cpuLoad() display() MICROGAMER_FRAME_BUFFERS
+   */
+  int busWaitLoad();
+
   /** \brief
    * Test if the specified buttons are pressed.
    *
@@ -967,6 +1935,65 @@ class MicroGamerBase : public MicroGamerCore
    */
   bool collide(Rect rect1, Rect rect2);
 
+  /** \brief
+   * Test if the pixels of two sprites touch.
+   *
+   * \param x1,y1 The location of the first sprite, as it's drawn.
+   * \param sprite1 An array in the format used by the `Sprites` class,
+   *                starting with the width and height.
+   * \param frame1 The frame of the first sprite.
+   * \param x2,y2 The location of the second sprite.
+   * \param sprite2 The array of the second sprite.
+   * \param frame2 The frame of the second sprite.
+   * \param contact A point set to where the sprites touch (optional).
+   *
+   * \return `true` if a set pixel of one sprite is on a set pixel of the
+   * other.
+   *
+   * \details
+   * The sprites' rectangles are tested first, and only the columns and rows
+   * where they overlap are compared, 4 columns at a time with the page bytes
+   * of the second sprite shifted to line up with the first. Without a
+   * contact point the test stops at the first overlapping word.
+   *
+   * The contact point is the top pixel of both sprites, and the leftmost if
+   * there's more than one in that row. Finding it compares the whole page
+   * row where the sprites first touch.
+   *
+   * The image frames are compared, for the `drawOverwrite()`,
+   * `drawSelfMasked()` and `drawErase()` format. To compare masks, or frames
+   * of `drawPlusMask()` arrays, use `collideBitmaps()`.
+   *
+   * \see collideBitmaps() collide(Rect, Rect)
+   */
+  static bool collide(int16_t x1, int16_t y1, const uint8_t *sprite1, uint8_t frame1,
+                      int16_t x2, int16_t y2, const uint8_t *sprite2, uint8_t frame2,
+                      Point *contact = NULL);
+
+  /** \brief
+   * Test if the set pixels of two bitmaps touch.
+   *
+   * \param x1,y1 The location of the first bitmap.
+   * \param bitmap1 The first bitmap, in the format used by `drawBitmap()`.
+   * \param w1,h1 The width and height of the first bitmap.
+   * \param x2,y2 The location of the second bitmap.
+   * \param bitmap2 The second bitmap.
+   * \param w2,h2 The width and height of the second bitmap.
+   * \param contact A point set to where the bitmaps touch (optional).
+   *
+   * \return `true` if a set pixel of one bitmap is on a set pixel of the
+   * other.
+   *
+   * \details
+   * This works like the sprite `collide()`, on bitmaps without the width and
+   * height at the start, such as the masks of `drawExternalMask()`.
+   *
+   * \see collide(int16_t, int16_t, const uint8_t*, uint8_t, int16_t, int16_t, const uint8_t*, uint8_t, Point*)
+   */
+  static bool collideBitmaps(int16_t x1, int16_t y1, const uint8_t *bitmap1, uint8_t w1, uint8_t h1,
+                             int16_t x2, int16_t y2, const uint8_t *bitmap2, uint8_t w2, uint8_t h2,
+                             Point *contact = NULL);
+
   /** \brief
    * Read the unit ID from system EEPROM.
    *
@@ -1141,9 +2168,285 @@ class MicroGamerBase : public MicroGamerCore
 
  protected:
 
-  // Static allocation of a single frame buffer. When double buffering is
-  // enabled, the second buffer is allocated dynamically with malloc().
-  static uint8_t staticAllocatedBuffer[(HEIGHT*WIDTH)/8];
+  // Operations recorded in the display list
+  enum DisplayListOp {
+    DL_DRAW_PIXEL,
+    DL_DRAW_CIRCLE,
+    DL_DRAW_CIRCLE_HELPER,
+    DL_FILL_CIRCLE,
+    DL_FILL_CIRCLE_PATTERN,
+    DL_FILL_CIRCLE_HELPER,
+    DL_DRAW_ELLIPSE,
+    DL_FILL_ELLIPSE,
+    DL_DRAW_ARC,
+    DL_DRAW_LINE,
+    DL_DRAW_POLYLINE,
+    DL_DRAW_LINES,
+    DL_DRAW_RECT,
+    DL_DRAW_FAST_VLINE,
+    DL_DRAW_FAST_HLINE,
+    DL_FILL_RECT,
+    DL_FILL_RECT_PATTERN,
+    DL_FILL_SCREEN,
+    DL_FILL_SCREEN_PATTERN,
+    DL_DRAW_ROUND_RECT,
+    DL_FILL_ROUND_RECT,
+    DL_FILL_ROUND_RECT_PATTERN,
+    DL_DRAW_TRIANGLE,
+    DL_FILL_TRIANGLE,
+    DL_FILL_TRIANGLE_PATTERN,
+    DL_FILL_POLYGON,
+    DL_DRAW_BITMAP,
+    DL_DRAW_SURFACE,
+    DL_DRAW_TILEMAP,
+    DL_DRAW_SLOW_XY_BITMAP,
+    DL_DRAW_COMPRESSED,
+    DL_DRAW_CHAR,
+    DL_SPRITES_DRAW_BITMAP,
+    DL_SPRITES_DRAW_TRANSFORMED,
+    DL_SET_CLIP_RECT,
+    DL_SET_ORIGIN
+  };
+
+#if MICROGAMER_DISPLAY_LIST_SIZE
+  // The display list and the two stripes its pages are drawn into.
+  static uint8_t displayList[MICROGAMER_DISPLAY_LIST_SIZE];
+  static uint16_t displayListLength;
+  static bool displayListFull;
+  static bool replayingDisplayList;
+  static uint8_t displayListStripes[2][WIDTH];
+
+  // Record a draw call touching rows top to bottom (inclusive, in drawing
+  // coordinates) and return true, or return false if the call has to be
+  // drawn now. Calls outside of the clip rows are dropped.
+  static bool recordDrawCall(uint8_t op, int16_t top, int16_t bottom,
+                             const int16_t *args, uint8_t argCount,
+                             const uint8_t *bitmap = NULL,
+                             const uint8_t *mask = NULL);
+  // Record a call drawing on the pages set in pageMask
+  static bool recordEntry(uint8_t op, uint8_t pageMask,
+                          const int16_t *args, uint8_t argCount,
+                          const uint8_t *bitmap, const uint8_t *mask);
+  void paintDisplayList();
+  virtual void drawDisplayListEntry(uint8_t op, const int16_t *args,
+                                    const uint8_t * const *pointers);
+#else
+  // Without a display list, all draw calls are drawn right away.
+  static inline bool recordDrawCall(uint8_t /* op */, int16_t /* top */,
+                                    int16_t /* bottom */,
+                                    const int16_t * /* args */,
+                                    uint8_t /* argCount */,
+                                    const uint8_t * /* bitmap */ = NULL,
+                                    const uint8_t * /* mask */ = NULL)
+  {
+    return false;
+  }
+  static inline bool recordEntry(uint8_t /* op */, uint8_t /* pageMask */,
+                                 const int16_t * /* args */,
+                                 uint8_t /* argCount */,
+                                 const uint8_t * /* bitmap */,
+                                 const uint8_t * /* mask */)
+  {
+    return false;
+  }
+
+  // Static allocation of the frame buffers. When double buffering is enabled
+  // with a single static buffer, the second buffer is allocated dynamically
+  // with malloc().
+  static uint8_t staticAllocatedBuffer[MICROGAMER_FRAME_BUFFERS][(HEIGHT*WIDTH)/8];
+#endif
+
+#if MICROGAMER_SPRITE_CACHE_SIZE
+  // An image decoded by drawCompressed() into the sprite cache
+  struct SpriteCacheEntry
+  {
+    const uint8_t *source; // the array passed to drawCompressed()
+    const uint8_t *start;  // the compressed data of the frame in source
+    uint16_t offset;       // the decoded image in spriteCache
+    uint16_t size;
+    uint8_t frame;
+    uint8_t width;
+    uint8_t height;
+  };
+
+  // The decoded images, packed from the start, and their entries, most
+  // recently used first.
+  static uint8_t spriteCache[MICROGAMER_SPRITE_CACHE_SIZE];
+  static SpriteCacheEntry spriteCacheEntries[MICROGAMER_SPRITE_CACHE_ENTRIES];
+  static uint8_t spriteCacheCount;
+  static uint16_t spriteCacheUsed;
+  static unsigned long spriteCacheHitCount;
+  static unsigned long spriteCacheMissCount;
+
+  // Find a compressed image in the cache and make it the most recently used.
+  // It's found by the arguments of drawCompressed(), or by the frame's own
+  // data with frame 0 as recorded in the display list.
+  static SpriteCacheEntry *spriteCacheFind(const uint8_t *bitmap,
+                                           uint8_t frame);
+  // Make room for an image of size bytes and add its entry, as the most
+  // recently used
+  static SpriteCacheEntry *spriteCacheAdd(const uint8_t *source,
+                                          uint8_t frame,
+                                          const uint8_t *start,
+                                          uint8_t width, uint8_t height,
+                                          uint16_t size);
+#endif
+
+  // The clip rectangle set by setClipRect(), in target coordinates with the
+  // right and bottom edges excluded, and the origin set by setOrigin()
+  struct ViewState
+  {
+    int16_t left;
+    int16_t top;
+    int16_t right;
+    int16_t bottom;
+    int16_t originX;
+    int16_t originY;
+  };
+  static ViewState view;
+#if MICROGAMER_DISPLAY_LIST_SIZE
+  // The view at the start of the display list, which display() goes back to
+  // before drawing each page
+  static ViewState displayListView;
+#endif
+
+  // The range of target rows that can be drawn on: the whole target except
+  // while display() draws a display list, where it's the page being drawn
+  static int16_t bandTop;
+  static int16_t bandBottom;
+
+  // The area the drawing functions can modify, in target coordinates: the
+  // columns from clipLeft to clipRight - 1 and the rows from clipTop to
+  // clipBottom - 1. It's the clip rectangle limited to the target and the
+  // band, and it's all 0 when nothing can be drawn.
+  static int16_t clipLeft;
+  static int16_t clipRight;
+  static int16_t clipTop;
+  static int16_t clipBottom;
+
+  // Work out the clip area from the view, the target and the band
+  static void updateClip();
+
+  // The bytes of the pages that the top and bottom edges of the clip area
+  // cross when they aren't on page boundaries. Sprites are drawn as whole
+  // pages, so the rows of those pages outside of the clip area are saved
+  // for a run of columns before drawing and put back after.
+  static const uint8_t CLIP_EDGE_COLUMNS = 32;
+  struct ClipEdges
+  {
+    uint8_t *pages[2]; // the first column of each page, NULL if not saved
+    uint8_t keep[2];   // the rows of each page outside of the clip area
+    uint8_t count;     // the number of columns saved
+    uint8_t bytes[2][CLIP_EDGE_COLUMNS];
+  };
+
+  static inline bool clipEdgesPartial()
+  {
+    return ((clipTop | clipBottom) & 7) != 0;
+  }
+  static void clipEdgesSave(ClipEdges *edges, int16_t x, uint8_t count);
+  static void clipEdgesRestore(const ClipEdges *edges);
+
+  // The rows of the clip rectangle on the target, without the limit of the
+  // page being drawn by display(). Calls are rejected against these, as
+  // bitmaps drawn as whole pages can draw past their height.
+  static inline int16_t clipRectTop()
+  {
+    return max(view.top, 0);
+  }
+  static inline int16_t clipRectBottom()
+  {
+    return min(view.bottom, targetHeight);
+  }
+
+  // Check if a rectangle in drawing coordinates is all outside of the clip
+  // rectangle, so that nothing it covers has to be drawn
+  static inline bool clippedOut(int16_t x, int16_t y, int16_t w, int16_t h)
+  {
+    x += view.originX;
+    y += view.originY;
+    return x + w <= clipLeft || x >= clipRight ||
+           y + h <= clipRectTop() || y >= clipRectBottom();
+  }
+
+  // The surface drawn on, or NULL for the display buffer, its size and the
+  // display buffer pointer to go back to
+  static Surface *renderTarget;
+  static int16_t targetWidth;
+  static int16_t targetHeight;
+  static uint8_t *screenBuffer;
+
+  // Mark the columns of a page as drawn, as dirty regions of the display
+  // when drawing on the display buffer
+  static inline void markDrawn(uint8_t page, uint8_t first, uint8_t last);
+
+  // The pattern fillSpan() masks the pixels with, or NULL to fill them all.
+  // It's only set while a pattern fill function draws.
+  static const uint8_t *fillPattern;
+
+  // The bits of a nibble, each one repeated 2, 3 or 4 times, for text and
+  // sprites drawn at sizes 2 to 4
+  static const uint16_t expandedNibbles[3][16];
+
+  // The directions of the ends of an arc drawn by drawArc(), scaled by 1024,
+  // and its center. The arc is a major one when it's longer than a half
+  // circle.
+  struct ArcWedge
+  {
+    int16_t startX;
+    int16_t startY;
+    int16_t endX;
+    int16_t endY;
+    int16_t x0;
+    int16_t y0;
+    bool major;
+  };
+
+  // Draw all the pixels from (x0, y0) to (x1, y1) inclusive, in drawing
+  // coordinates
+  static inline void fillSpan(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                              uint8_t color)
+  {
+    fillTargetSpan(x0 + view.originX, y0 + view.originY,
+                   x1 + view.originX, y1 + view.originY, color);
+  }
+
+  // Draw all the pixels from (x0, y0) to (x1, y1) inclusive, in target
+  // coordinates, clipped to the clip area and marked dirty. The masks of the
+  // top and bottom pages are worked out once, and the pages between them
+  // are written as whole bytes.
+  static void fillTargetSpan(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                             uint8_t color);
+
+  // Draw a line with the pixels of Bresenham's algorithm, clipped before it's
+  // walked and drawn as runs of pixels. The pixel at (x0, y0) is left out if
+  // skipStart is true, and the one at (x1, y1) if skipEnd is true.
+  static void drawLineSegment(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                              uint8_t color, bool skipStart, bool skipEnd);
+
+  // Fill a convex polygon, row by row between its edges
+  static void fillConvexPolygon(const Point *points, uint8_t count,
+                                uint8_t color);
+
+  // Draw a row or column span, or only the pixels of it that are in an arc
+  static void drawOutlineSpan(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                              uint8_t color, const ArcWedge *arc);
+
+  // Draw the corners of an ellipse outline split into four, centered on
+  // (xl, yt), (xr, yt), (xr, yb) and (xl, yb), each pixel once. Corners is a
+  // mask of the corners drawn, as for drawCircleHelper(). The pixels on the
+  // axes of the corners and the straight edges between them are only drawn
+  // for the whole outline, with all four corners.
+  static void drawEllipseCorners(int16_t xl, int16_t yt, int16_t xr, int16_t yb,
+                                 uint8_t rx, uint8_t ry, uint8_t corners,
+                                 bool whole, uint8_t color,
+                                 const ArcWedge *arc = NULL);
+
+  // Fill the columns left of xl and right of xr of an ellipse split as for
+  // drawEllipseCorners(), with sides as for fillCircleHelper().
+  static void fillEllipseSides(int16_t xl, int16_t yt, int16_t xr, int16_t yb,
+                               uint8_t rx, uint8_t ry, uint8_t sides,
+                               uint8_t color);
 
   // helper function for sound enable/disable system control
   void sysCtrlSound(uint8_t buttons, uint8_t led, uint8_t eeVal);
@@ -1164,8 +2467,44 @@ class MicroGamerBase : public MicroGamerCore
   unsigned long nextFrameStart;
   bool justRendered;
   uint8_t lastFrameDurationMs;
-
-  static uint8_t *displayBuffer;
+  unsigned long busWaitMicros;
+  unsigned long lastBusWaitMicros;
+
+  // The display buffers. `sBuffer` is frameBuffers[bufferIndex].
+  static uint8_t *frameBuffers[FRAME_BUFFERS_MAX];
+  static uint8_t frameBufferCount;
+  static bool dropFrames;
+  static unsigned long framesDroppedCount;
+
+  // For dirty region tracking. The drawing functions record what they modify
+  // in `dirty`. The other spans are kept for each buffer: `drawnSpans` is
+  // what may be non-zero since the last clear() and `pendingSpans` what
+  // differs from the latest frame displayed, in addition to `dirty`.
+  // `displayedSpans` is what the latest frame displayed was sent for and
+  // `resendSpans` what has to be sent with the next frame even if unchanged.
+  static bool trackDirty;
+  static PageSpans dirty;
+  static PageSpans resendSpans;
+  static PageSpans drawnSpans[FRAME_BUFFERS_MAX];
+  static PageSpans pendingSpans[FRAME_BUFFERS_MAX];
+  static PageSpans displayedSpans;
+  static uint8_t bufferIndex;
+  // the buffers of the latest frame displayed and of the one before it
+  static uint8_t displayedIndex;
+  static uint8_t previousDisplayedIndex;
+  static uint16_t lastDisplayByteCount;
+  static unsigned long displayBytesSavedCount;
+
+  // The display start line set by scrollVertical(), sent with the next
+  // frame when startLineChanged is set. startLineQueued is set when the
+  // latest frame was given a start line, which has to be given to the next
+  // one instead if that frame is dropped.
+  static uint8_t startLine;
+  static bool startLineChanged;
+  static bool startLineQueued;
+
+  // The start line to send with the next frame, or -1 if it didn't change
+  static int8_t frameStartLine();
 };
 
 
@@ -1298,6 +2637,24 @@ class MicroGamer : public Print, public MicroGamerBase
    */
   virtual size_t write(uint8_t);
 
+  /** \brief
+   * Write a number of characters to the screen buffer.
+   *
+   * \param buffer The characters to be written.
+   * \param size The number of characters.
+   *
+   * \return The number of characters written (will always be `size`).
+   *
+   * \details
+   * This is the MicroGamer implementation of the Arduino virtual `write()`
+   * function for a buffer of characters, used when the Print class prints a
+   * string or number. The characters are drawn the same as with
+   * `write(uint8_t)`, but the text cursor is only updated once at the end.
+   *
+   * \see Print write(uint8_t) drawChar()
+   */
+  virtual size_t write(const uint8_t *buffer, size_t size);
+
   /** \brief
    * Draw a single ASCII character at the specified location in the screen
    * buffer.
@@ -1314,6 +2671,9 @@ class MicroGamer : public Print, public MicroGamerBase
    * coordinate. The point specified by the X and Y coordinates will be the
    * top left corner of the character.
    *
+   * At sizes 1 to 4, each column of the character is written to the screen
+   * buffer a byte at a time. Larger sizes are drawn a pixel at a time.
+   *
    * \note
    * This is a low level function used by the `write()` function to draw a
    * character. Although it's available as a public function, it wouldn't
@@ -1440,7 +2800,7 @@ class MicroGamer : public Print, public MicroGamerBase
    * Text wrap mode is enabled by specifying `true`. In wrap mode, the text
    * cursor will be moved to the start of the next line (based on the current
    * text size) if the following character wouldn't fit entirely at the end of
-   * the current line.
+   * the current line. Lines end at the right edge of the clip rectangle.
 
    * If wrap mode is disabled, characters will continue to be written to the
    * same line. A character at the right edge of the screen may only be
@@ -1465,6 +2825,11 @@ class MicroGamer : public Print, public MicroGamerBase
   void clear();
 
  protected:
+#if MICROGAMER_DISPLAY_LIST_SIZE
+  virtual void drawDisplayListEntry(uint8_t op, const int16_t *args,
+                                    const uint8_t * const *pointers);
+#endif
+
   int16_t cursor_x;
   int16_t cursor_y;
   uint8_t textColor;
@@ -1474,5 +2839,8 @@ class MicroGamer : public Print, public MicroGamerBase
 
 };
 
+// Sprites uses MicroGamerBase in its inline template functions
+#include "Sprites.h"
+
 #endif
 
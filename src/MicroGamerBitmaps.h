@@ -0,0 +1,234 @@
+/**
+ * @file MicroGamerBitmaps.h
+ * \brief
+ * Templates that convert bitmaps to the display's page format at compile
+ * time.
+ */
+
+#ifndef MICROGAMER_BITMAPS_H
+#define MICROGAMER_BITMAPS_H
+
+#include "MicroGamer.h"
+
+// The building blocks of XYBitmap and AsciiBitmap
+// (Not officially part of the API)
+namespace MicroGamerBitmaps
+{
+  // A list of the array indexes 0 to N - 1, built in log2(N) steps so that
+  // large bitmaps don't go past the compiler's template depth limit
+  template<uint16_t... I>
+  struct Indices
+  {
+    typedef Indices<I..., (sizeof...(I) + I)...> Doubled;
+    typedef Indices<I..., sizeof...(I)> Next;
+  };
+
+  template<uint16_t N>
+  struct MakeIndices;
+
+  template<uint16_t N, bool Odd>
+  struct MakeIndicesStep
+  {
+    typedef typename MakeIndices<N / 2>::Type::Doubled Type;
+  };
+
+  template<uint16_t N>
+  struct MakeIndicesStep<N, true>
+  {
+    typedef typename MakeIndices<N / 2>::Type::Doubled::Next Type;
+  };
+
+  template<uint16_t N>
+  struct MakeIndices
+  {
+    typedef typename MakeIndicesStep<N, N % 2>::Type Type;
+  };
+
+  template<>
+  struct MakeIndices<0>
+  {
+    typedef Indices<> Type;
+  };
+
+  // The pixels of a horizontally oriented array, as used by
+  // drawSlowXYBitmap(): each byte is 8 pixels of a row, the most significant
+  // bit at the left, and each row starts on a new byte
+  template<const uint8_t *Data, uint8_t W>
+  struct XYPixels
+  {
+    static constexpr uint8_t pixel(uint16_t x, uint16_t y)
+    {
+      return (Data[(y * ((W + 7) / 8)) + (x / 8)] >> (7 - (x % 8))) & 1;
+    }
+  };
+
+  // The pixels of a string of W characters for each row, '.' and ' ' being
+  // pixels that aren't set
+  template<const char *Art, uint8_t W>
+  struct AsciiPixels
+  {
+    static constexpr uint8_t pixel(uint16_t x, uint16_t y)
+    {
+      return (Art[(y * W) + x] != '.' && Art[(y * W) + x] != ' ') ? 1 : 0;
+    }
+  };
+
+  // The bytes of the frames of a bitmap in page format, each frame being
+  // H rows of the pixels, with the width and height first for a sprite
+  template<typename Pixels, uint8_t W, uint8_t H, bool Sprite>
+  struct PageBytes
+  {
+    static const uint16_t FRAME_SIZE = W * ((H + 7) / 8);
+
+    // The bits of the rows from row down of a column, up to the frame height
+    static constexpr uint8_t column(uint16_t x, uint16_t frame, uint8_t row,
+                                    uint8_t bit)
+    {
+      return (bit == 8 || row + bit >= H) ? 0 :
+             (Pixels::pixel(x, (frame * H) + row + bit) << bit) |
+             column(x, frame, row, bit + 1);
+    }
+
+    static constexpr uint8_t frameByte(uint16_t i)
+    {
+      return column((i % FRAME_SIZE) % W, i / FRAME_SIZE,
+                    ((i % FRAME_SIZE) / W) * 8, 0);
+    }
+
+    static constexpr uint8_t byte(uint16_t i)
+    {
+      return !Sprite ? frameByte(i) :
+             (i == 0) ? W :
+             (i == 1) ? H :
+             frameByte(i - 2);
+    }
+  };
+
+  // An array of the bytes of a PageBytes type
+  template<typename Bytes, typename I>
+  struct PageArray;
+
+  template<typename Bytes, uint16_t... I>
+  struct PageArray<Bytes, Indices<I...> >
+  {
+    static const uint8_t data[sizeof...(I)];
+  };
+
+  template<typename Bytes, uint16_t... I>
+  const uint8_t PageArray<Bytes, Indices<I...> >::data[sizeof...(I)] PROGMEM =
+    { Bytes::byte(I)... };
+
+  // The page format arrays of the frames of a bitmap
+  template<typename Pixels, uint8_t W, uint8_t H, uint8_t Frames>
+  struct PageBitmap
+  {
+    static_assert(W > 0 && H > 0 && Frames > 0, "empty bitmap");
+    static_assert((uint32_t)W * ((H + 7) / 8) * Frames <= 0xFFFD,
+                  "bitmap too large");
+
+    static const uint16_t SIZE = W * ((H + 7) / 8) * Frames;
+
+    static constexpr const uint8_t *bitmap =
+      PageArray<PageBytes<Pixels, W, H, false>,
+                typename MakeIndices<SIZE>::Type>::data;
+    static constexpr const uint8_t *sprite =
+      PageArray<PageBytes<Pixels, W, H, true>,
+                typename MakeIndices<SIZE + 2>::Type>::data;
+  };
+
+  template<typename Pixels, uint8_t W, uint8_t H, uint8_t Frames>
+  constexpr const uint8_t *PageBitmap<Pixels, W, H, Frames>::bitmap;
+
+  template<typename Pixels, uint8_t W, uint8_t H, uint8_t Frames>
+  constexpr const uint8_t *PageBitmap<Pixels, W, H, Frames>::sprite;
+}
+
+/** \brief
+ * A horizontally oriented bitmap converted to page format at compile time.
+ *
+ * \tparam Data The array of the bitmap, in the format used by
+ * `drawSlowXYBitmap()`. It must be declared `constexpr`.
+ * \tparam W,H The width and height of the bitmap.
+ * \tparam Frames The number of frames, stored one below the other in the
+ * array (optional; defaults to 1).
+ *
+ * \details
+ * Bitmaps made for other displays, such as Adafruit GFX bitmaps, have each
+ * byte holding 8 pixels of a row. Drawing them with `drawSlowXYBitmap()`
+ * draws every pixel on its own. This template has the compiler convert them
+ * to the format of the display pages instead, so they can be drawn with
+ * `drawBitmap()` or the `Sprites` functions. The converted array is stored
+ * in program memory and nothing is converted when the sketch runs.
+ *
+ * - `bitmap` is the converted array for `drawBitmap()`.
+ * - `sprite` is the same array starting with the width and height, for the
+ *   `Sprites` functions. Each frame starts on a new page row.
+ *
+ * Only the arrays that are used are stored, and the original array doesn't
+ * take any space unless it's used elsewhere.
+ *
+ * \code
+ * #include <MicroGamerBitmaps.h>
+ *
+ * constexpr uint8_t logoXY[] = {
+ *   0x3C, 0x42, 0x81, 0xA5, 0x81, 0x99, 0x42, 0x3C
+ * };
+ * typedef XYBitmap<logoXY, 8, 8> Logo;
+ *
+ * mg.drawBitmap(x, y, Logo::bitmap, 8, 8);
+ * Sprites::drawSelfMasked(x, y, Logo::sprite, 0);
+ * \endcode
+ *
+ * \see AsciiBitmap MicroGamerBase::drawSlowXYBitmap()
+ */
+template<const uint8_t *Data, uint8_t W, uint8_t H, uint8_t Frames = 1>
+struct XYBitmap :
+  MicroGamerBitmaps::PageBitmap<MicroGamerBitmaps::XYPixels<Data, W>,
+                                W, H, Frames>
+{
+};
+
+/** \brief
+ * A bitmap drawn as text, converted to page format at compile time.
+ *
+ * \tparam Art A string of `W` characters for each row of each frame. It must
+ * be declared `constexpr`.
+ * \tparam W,H The width and height of the bitmap.
+ * \tparam Frames The number of frames, one below the other in the string
+ * (optional; defaults to 1).
+ *
+ * \details
+ * The characters `.` and space are pixels that aren't set, and any other
+ * character is a pixel that is. The string must have exactly
+ * `W * H * Frames` characters, which is checked by the compiler. Writing
+ * each row as a separate string literal keeps the picture readable, as they
+ * are joined into a single string.
+ *
+ * As with `XYBitmap`, the converted arrays are `bitmap`, for `drawBitmap()`,
+ * and `sprite`, for the `Sprites` functions.
+ *
+ * \code
+ * #include <MicroGamerBitmaps.h>
+ *
+ * constexpr char shipArt[] =
+ *   "...##..."
+ *   "..####.."
+ *   ".##..##."
+ *   "########";
+ * typedef AsciiBitmap<shipArt, 8, 4> Ship;
+ *
+ * Sprites::drawSelfMasked(x, y, Ship::sprite, 0);
+ * \endcode
+ *
+ * \see XYBitmap
+ */
+template<const char *Art, uint8_t W, uint8_t H, uint8_t Frames = 1>
+struct AsciiBitmap :
+  MicroGamerBitmaps::PageBitmap<MicroGamerBitmaps::AsciiPixels<Art, W>,
+                                W, H, Frames>
+{
+  static_assert(Art[W * H * Frames] == '\0',
+                "the art must have W * H * Frames characters");
+};
+
+#endif
@@ -0,0 +1,200 @@
+/**
+ * @file MicroGamerConsole.cpp
+ * \brief
+ * A character cell text console drawn on the MicroGamer display.
+ */
+
+#include "MicroGamerConsole.h"
+
+// the bits of all the columns of a row in dirty[][]
+#define CONSOLE_ALL_COLUMNS ((1UL << MicroGamerConsole::COLUMNS) - 1)
+
+MicroGamerConsole::MicroGamerConsole(MicroGamer &mg)
+  : mg(mg)
+  , cursorColumn(0)
+  , cursorRow(0)
+  , attributes(CONSOLE_NORMAL)
+{
+  memset(text, ' ', sizeof(text));
+  memset(attrs, CONSOLE_NORMAL, sizeof(attrs));
+  memset(scrolled, 0, sizeof(scrolled));
+  invalidate();
+}
+
+size_t MicroGamerConsole::write(uint8_t c)
+{
+  if (c == '\n')
+  {
+    cursorColumn = 0;
+    cursorRow++;
+  }
+  else if (c == '\r')
+  {
+    cursorColumn = 0;
+  }
+  else
+  {
+    if (cursorColumn >= COLUMNS)
+    {
+      cursorColumn = 0;
+      cursorRow++;
+    }
+    if (cursorRow >= ROWS)
+    {
+      scroll();
+      cursorRow = ROWS - 1;
+    }
+    setCell(cursorColumn, cursorRow, c, attributes);
+    cursorColumn++;
+    return 1;
+  }
+
+  if (cursorRow >= ROWS)
+  {
+    scroll();
+    cursorRow = ROWS - 1;
+  }
+  return 1;
+}
+
+void MicroGamerConsole::clear()
+{
+  for (uint8_t row = 0; row < ROWS; row++) {
+    for (uint8_t column = 0; column < COLUMNS; column++) {
+      setCell(column, row, ' ', CONSOLE_NORMAL);
+    }
+  }
+  cursorColumn = 0;
+  cursorRow = 0;
+}
+
+void MicroGamerConsole::setCursor(uint8_t column, uint8_t row)
+{
+  cursorColumn = (column < COLUMNS) ? column : COLUMNS - 1;
+  cursorRow = (row < ROWS) ? row : ROWS - 1;
+}
+
+uint8_t MicroGamerConsole::getCursorColumn()
+{
+  return cursorColumn;
+}
+
+uint8_t MicroGamerConsole::getCursorRow()
+{
+  return cursorRow;
+}
+
+void MicroGamerConsole::setAttributes(uint8_t attributes)
+{
+  this->attributes = attributes;
+}
+
+uint8_t MicroGamerConsole::getAttributes()
+{
+  return attributes;
+}
+
+void MicroGamerConsole::scroll()
+{
+  memmove(text[0], text[1], (ROWS - 1) * COLUMNS);
+  memmove(attrs[0], attrs[1], (ROWS - 1) * COLUMNS);
+  memset(text[ROWS - 1], ' ', COLUMNS);
+  memset(attrs[ROWS - 1], CONSOLE_NORMAL, COLUMNS);
+
+  // The cells of each buffer move up with the text when it's rendered, so
+  // they stay as dirty as they were. The new row has to be drawn.
+  for (uint8_t i = 0; i < FRAME_BUFFERS_MAX; i++) {
+    memmove(&dirty[i][0], &dirty[i][1], (ROWS - 1) * sizeof(dirty[i][0]));
+    dirty[i][ROWS - 1] = CONSOLE_ALL_COLUMNS;
+    if (scrolled[i] < ROWS) {
+      scrolled[i]++;
+    }
+  }
+}
+
+void MicroGamerConsole::render()
+{
+  // the console is always on the display buffer, at the top left of the
+  // screen, so the render target and view are put back afterwards
+  Surface *target = mg.getRenderTarget();
+  MicroGamerBase::ViewState view = mg.view;
+  bool moved = target != NULL || view.left != 0 || view.top != 0 ||
+               view.right != WIDTH || view.bottom != HEIGHT ||
+               view.originX != 0 || view.originY != 0;
+
+  if (moved)
+    mg.setRenderTarget(NULL);
+
+#if MICROGAMER_DISPLAY_LIST_SIZE
+  // nothing is kept from the previous frame
+  for (uint8_t row = 0; row < ROWS; row++) {
+    for (uint8_t column = 0; column < COLUMNS; column++) {
+      if (text[row][column] != ' ' || attrs[row][column] != CONSOLE_NORMAL) {
+        drawCell(column, row);
+      }
+    }
+  }
+#else
+  uint8_t buffer = mg.bufferIndex;
+  uint8_t *sBuffer = mg.getBuffer();
+  uint8_t lines = scrolled[buffer];
+
+  // move the rows still on the console up, rather than drawing them again
+  if (lines > 0 && lines < ROWS) {
+    for (uint8_t row = 0; row < ROWS - lines; row++) {
+      memcpy(sBuffer + (row * WIDTH), sBuffer + ((row + lines) * WIDTH),
+             COLUMNS * 6);
+    }
+    mg.markDirty(0, 0, COLUMNS * 6, (ROWS - lines) * 8);
+  }
+  scrolled[buffer] = 0;
+
+  for (uint8_t row = 0; row < ROWS; row++) {
+    uint32_t cells = dirty[buffer][row];
+
+    for (uint8_t column = 0; cells != 0; column++, cells >>= 1) {
+      if (cells & 1) {
+        drawCell(column, row);
+      }
+    }
+    dirty[buffer][row] = 0;
+  }
+#endif
+
+  if (moved) {
+    mg.setRenderTarget(target);
+    mg.setClipRect(view.left, view.top, view.right - view.left,
+                   view.bottom - view.top);
+    mg.setOrigin(view.originX, view.originY);
+  }
+}
+
+void MicroGamerConsole::invalidate()
+{
+  for (uint8_t i = 0; i < FRAME_BUFFERS_MAX; i++) {
+    for (uint8_t row = 0; row < ROWS; row++) {
+      dirty[i][row] = CONSOLE_ALL_COLUMNS;
+    }
+  }
+}
+
+void MicroGamerConsole::setCell(uint8_t column, uint8_t row, uint8_t c,
+                                uint8_t attributes)
+{
+  if (text[row][column] == c && attrs[row][column] == attributes)
+    return;
+
+  text[row][column] = c;
+  attrs[row][column] = attributes;
+  for (uint8_t i = 0; i < FRAME_BUFFERS_MAX; i++) {
+    dirty[i][row] |= 1UL << column;
+  }
+}
+
+void MicroGamerConsole::drawCell(uint8_t column, uint8_t row)
+{
+  bool invert = attrs[row][column] & CONSOLE_INVERT;
+
+  mg.drawChar(column * 6, row * 8, text[row][column],
+              invert ? BLACK : WHITE, invert ? WHITE : BLACK, 1);
+}
@@ -0,0 +1,204 @@
+/**
+ * @file MicroGamerConsole.h
+ * \brief
+ * A character cell text console drawn on the MicroGamer display.
+ */
+
+#ifndef MICROGAMER_CONSOLE_H
+#define MICROGAMER_CONSOLE_H
+
+#include "MicroGamer.h"
+
+#define CONSOLE_NORMAL 0 /**< Attribute for white text on a black background. */
+#define CONSOLE_INVERT 1 /**< Attribute for black text on a white background. */
+
+/** \brief
+ * A text console of 21 by 8 character cells.
+ *
+ * \details
+ * The console keeps a grid of characters, each with its own attributes,
+ * covering the display. Text is written to the grid with the Arduino Print
+ * functions, and `render()` then draws the cells that changed since they
+ * were last drawn, using `MicroGamer::drawChar()`. Cells that are written
+ * with the same character and attributes aren't drawn again, so a status
+ * screen printed every frame only costs the time of the text that changes.
+ *
+ * Drawn cells are marked as dirty, so with dirty region tracking enabled
+ * `display()` only sends the pages and columns of the cells that changed.
+ * Scrolling moves the page rows of the display buffer instead of drawing the
+ * cells again.
+ *
+ * The cells are 6 pixels wide and 8 pixels high, lined up with the display
+ * pages. The 2 columns of pixels on the right of the display aren't used.
+ *
+ * The sketch must not clear the area of the console between frames. If it
+ * was cleared or drawn over, `invalidate()` makes `render()` draw all the
+ * cells again. In the low RAM display mode, where the screen has to be
+ * cleared each frame, `render()` draws all the cells that aren't blank.
+ *
+ * Example:
+ *
+ * \code
+ * #include <MicroGamerConsole.h>
+ *
+ * MicroGamer mg;
+ * MicroGamerConsole console(mg);
+ *
+ * void loop() {
+ *   if (!mg.nextFrame())
+ *     return;
+ *
+ *   console.setCursor(0, 0);
+ *   console.print(F("Score "));
+ *   console.print(score);
+ *   console.render();
+ *   mg.display();
+ * }
+ * \endcode
+ */
+class MicroGamerConsole : public Print
+{
+ public:
+  static const uint8_t COLUMNS = WIDTH / 6; /**< The number of cells in a row. */
+  static const uint8_t ROWS = HEIGHT / 8;   /**< The number of rows of cells. */
+
+  /** \brief
+   * The MicroGamerConsole class constructor.
+   *
+   * \param mg The MicroGamer object used to draw the characters.
+   *
+   * \details
+   * All the cells start blank, and are drawn by the first `render()`.
+   */
+  MicroGamerConsole(MicroGamer &mg);
+
+  /** \brief
+   * Write a character to the cell at the cursor.
+   *
+   * \param c The ASCII value of the character to be written.
+   *
+   * \return The number of characters written (will always be 1).
+   *
+   * \details
+   * The character is written with the current attributes and the cursor
+   * moves to the next cell, or to the start of the next row at the end of a
+   * row. Writing past the last row scrolls the console up.
+   *
+   * Two special characters are handled:
+   *
+   * - The newline character `\n` moves the cursor to the start of the next
+   *   row.
+   * - The carriage return character `\r` moves the cursor to the start of
+   *   the row.
+   *
+   * \see setCursor() setAttributes() render()
+   */
+  virtual size_t write(uint8_t c);
+  using Print::write;
+
+  /** \brief
+   * Blank all the cells and move the cursor to the top left cell.
+   *
+   * \details
+   * The blanked cells are drawn by the next `render()`.
+   */
+  void clear();
+
+  /** \brief
+   * Set the cell where the next character will be written.
+   *
+   * \param column The column of the cell, from 0 to `COLUMNS - 1`.
+   * \param row The row of the cell, from 0 to `ROWS - 1`.
+   *
+   * \see getCursorColumn() getCursorRow()
+   */
+  void setCursor(uint8_t column, uint8_t row);
+
+  /** \brief
+   * Get the column of the cursor.
+   *
+   * \return The column of the cell where the next character will be written.
+   *
+   * \see setCursor() getCursorRow()
+   */
+  uint8_t getCursorColumn();
+
+  /** \brief
+   * Get the row of the cursor.
+   *
+   * \return The row of the cell where the next character will be written.
+   *
+   * \see setCursor() getCursorColumn()
+   */
+  uint8_t getCursorRow();
+
+  /** \brief
+   * Set the attributes of the characters written.
+   *
+   * \param attributes `CONSOLE_NORMAL` or `CONSOLE_INVERT`.
+   *
+   * \see getAttributes()
+   */
+  void setAttributes(uint8_t attributes);
+
+  /** \brief
+   * Get the attributes of the characters written.
+   *
+   * \return The current attributes.
+   *
+   * \see setAttributes()
+   */
+  uint8_t getAttributes();
+
+  /** \brief
+   * Scroll the console up by one row.
+   *
+   * \details
+   * The top row is removed and a blank row is added at the bottom. The next
+   * `render()` moves the page rows of the display buffer up instead of
+   * drawing the cells again.
+   */
+  void scroll();
+
+  /** \brief
+   * Draw the cells that changed since they were last drawn.
+   *
+   * \details
+   * This should be called once per frame, before `display()`. When there
+   * are several display buffers, each one is kept up to date separately.
+   *
+   * The cells are always drawn on the display buffer, from the top left of
+   * the screen. The render target, clip rectangle and origin that are set
+   * don't change where they go, and are the same afterwards.
+   *
+   * \see invalidate()
+   */
+  void render();
+
+  /** \brief
+   * Make the next `render()` draw all the cells.
+   *
+   * \details
+   * This is needed after the area of the console was cleared or drawn over.
+   */
+  void invalidate();
+
+ protected:
+  // Change a cell, marking it to be drawn if it's different
+  void setCell(uint8_t column, uint8_t row, uint8_t c, uint8_t attributes);
+  void drawCell(uint8_t column, uint8_t row);
+
+  MicroGamer &mg;
+  uint8_t text[ROWS][COLUMNS];
+  uint8_t attrs[ROWS][COLUMNS];
+  uint8_t cursorColumn;
+  uint8_t cursorRow;
+  uint8_t attributes;
+
+  // For each display buffer, the cells that differ from what it shows, one
+  // bit per column, and the rows it has to be scrolled up by
+  uint32_t dirty[FRAME_BUFFERS_MAX][ROWS];
+  uint8_t scrolled[FRAME_BUFFERS_MAX];
+};
+
+#endif
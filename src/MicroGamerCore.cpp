@@ -153,9 +153,78 @@ const uint8_t PROGMEM lcdBootProgram[] = {
   OLED_HORIZ_FLIPPED, OLED_VERTICAL_FLIPPED // Flip the screen
 };
 
+// All traffic to the display goes through the TWI interrupt handler.
+// Commands are queued in a ring buffer and everything queued is sent in a
+// single command transaction. Display data is sent as a list of windows,
+// each needing its column and page address range set by a command
+// transaction before its data transaction. Queued commands always go out
+// ahead of the next window. A start line given with the list is sent along
+// with the address of its first window, so it only moves the image once
+// that list is being sent.
+#define COMMAND_QUEUE_SIZE 64 // must be a power of 2
+#define COMMAND_QUEUE_MASK (COMMAND_QUEUE_SIZE - 1)
+
+// TWI transaction in progress
+#define TWI_IDLE 0
+#define TWI_COMMANDS 1
+#define TWI_DATA 2
+
+// Next step of the window list transfer
+#define PAINT_IDLE 0
+#define PAINT_WINDOW_ADDRESS 1
+#define PAINT_WINDOW_DATA 2
+
+// Times the address of a window is sent again after a failed transaction,
+// before the rest of the paint is given up on
+#define PAINT_ADDRESS_RETRIES 3
+
+static uint8_t commandQueue[COMMAND_QUEUE_SIZE];
+static volatile uint8_t commandQueueHead = 0; // written by sendLCDCommands()
+static volatile uint8_t commandQueueTail = 0; // written by the handler
+
+static void (*transferCompleteCallback)() = NULL;
+
 volatile bool twiInProgress = false;
+static volatile uint8_t twiState = TWI_IDLE;
+static uint8_t paintState = PAINT_IDLE;
+static const uint8_t *paintImage;
+static DisplayWindow paintWindowList[HEIGHT/8];
+static uint8_t paintWindowCount;
+static uint8_t paintWindowIndex;
+static uint8_t paintAddressRetries;
+static int8_t paintStartLine;
+
+// A paint waiting for the one in progress to finish
+static const uint8_t *volatile queuedPaintImage = NULL;
+static DisplayWindow queuedWindowList[HEIGHT/8];
+static uint8_t queuedWindowCount;
+static int8_t queuedStartLine;
+
+// Bytes of the transaction in progress: the control byte, then either the
+// queued commands followed by the window address commands (twiHeader), or
+// the image bytes of the window, one page row at a time.
+static uint8_t twiControl;
+static bool twiControlSent;
+static bool twiStopping;
+static bool twiFailed;
+static bool twiPaintLast; // the last transaction of the paint
+static uint8_t twiHeader[7];
+static uint8_t twiHeaderLength;
+static uint8_t twiHeaderIndex;
 const uint8_t *twiTxData = NULL;
 size_t twiByteToSend = 0;
+static uint8_t twiRowLength;
+static uint8_t twiRowLeft;
+
+// Transfer statistics. The bus load is measured over periods of at least
+// BUS_LOAD_PERIOD microseconds.
+#define BUS_LOAD_PERIOD 250000
+static DisplayStats twiStats;
+static unsigned long twiTransactionStart;
+static unsigned long paintStart;
+static uint16_t paintBytes;
+static unsigned long busLoadStart;
+static unsigned long busBusyMicros;
 
 MicroGamerCore::MicroGamerCore()
 {
@@ -201,9 +270,7 @@ void MicroGamerCore::bootOLED()
 
   // run our customized boot-up command sequence against the
   // OLED to initialize it properly for MicroGamer
-  for (uint8_t i = 0; i < sizeof(lcdBootProgram); i++) {
-    sendLCDCommand(pgm_read_byte(lcdBootProgram + i));
-  }
+  sendLCDCommands(lcdBootProgram, sizeof(lcdBootProgram));
 }
 
 void MicroGamerCore::bootTWI()
@@ -225,124 +292,190 @@ void MicroGamerCore::bootTWI()
 
 /* TWI  */
 
-void MicroGamerCore::twiBeginTransmission(uint8_t address)
+// Return the next byte of the transaction in progress or -1 at the end
+static int twiNextByte()
 {
-  TWI_DEVICE->ADDRESS = address;
-  TWI_DEVICE->SHORTS = 0x0UL;
-  TWI_DEVICE->TASKS_RESUME = 0x1UL;
-  TWI_DEVICE->TASKS_STARTTX = 0x1UL;
-}
-
-uint8_t MicroGamerCore::twiTransmit(const uint8_t data[],
-                                  size_t quantity)
-{
-  for(size_t i = 0; i < quantity; ++i)
-  {
-    TWI_DEVICE->TXD = data[i];
-
-    while(!TWI_DEVICE->EVENTS_TXDSENT && !TWI_DEVICE->EVENTS_ERROR);
-
-    if (TWI_DEVICE->EVENTS_ERROR)
-    {
-      break;
-    }
-
-    TWI_DEVICE->EVENTS_TXDSENT = 0x0UL;
+  if (twiStopping) {
+    return -1;
   }
 
-  if (TWI_DEVICE->EVENTS_ERROR)
-  {
-    TWI_DEVICE->EVENTS_ERROR = 0x0UL;
-
-    uint32_t error = TWI_DEVICE->ERRORSRC;
-
-    TWI_DEVICE->ERRORSRC = error;
+  if (!twiControlSent) {
+    twiControlSent = true;
+    return twiControl;
+  }
 
-    if (error == TWI_ERRORSRC_ANACK_Msk)
-    {
-      return 2;
+  if (twiState == TWI_COMMANDS) {
+    if (commandQueueTail != commandQueueHead) {
+      uint8_t command = commandQueue[commandQueueTail];
+      commandQueueTail = (commandQueueTail + 1) & COMMAND_QUEUE_MASK;
+      return command;
     }
-    else if (error == TWI_ERRORSRC_DNACK_Msk)
-    {
-      return 3;
-    }
-    else
-    {
-      return 4;
+    if (twiHeaderIndex < twiHeaderLength) {
+      return twiHeader[twiHeaderIndex++];
     }
+    return -1;
   }
 
-  return 0;
+  if (twiByteToSend == 0) {
+    return -1;
+  }
+
+  if (twiRowLeft == 0) {
+    // skip to the start of the window on the next page
+    twiTxData += WIDTH - twiRowLength;
+    twiRowLeft = twiRowLength;
+  }
+  twiRowLeft--;
+  twiByteToSend--;
+  return *twiTxData++;
 }
 
-void MicroGamerCore::twiTransmitAsync(const uint8_t data[],
-                                       size_t quantity)
+static inline void twiCountByte()
 {
+  twiStats.totalBytes++;
+  paintBytes++;
+}
 
-  if (quantity == 0) {
-    return;
+// Add the time the bus was busy until now to the bus load, and update the
+// bus load at the end of a period. Called with the TWI interrupt masked.
+static void twiAccountBusTime(unsigned long now)
+{
+  if (twiState != TWI_IDLE) {
+    busBusyMicros += now - twiTransactionStart;
+    twiTransactionStart = now;
   }
 
-  if (quantity > 1 ) {
-    twiInProgress = true;
-    twiTxData = data + 1;
-    twiByteToSend = quantity - 1;
+  unsigned long period = now - busLoadStart;
 
-    NVIC_ClearPendingIRQ(TWI_IRQn);
-    NVIC_EnableIRQ(TWI_IRQn);
+  if (period >= BUS_LOAD_PERIOD) {
+    twiStats.busLoad = min(busBusyMicros * 100 / period, 100UL);
+    busBusyMicros = 0;
+    busLoadStart = now;
   }
+}
 
-  TWI_DEVICE->TXD = data[0];
+// Called when a paint starts or ends, with the TWI interrupt masked
+static void twiPaintStarted()
+{
+  paintStart = micros();
+  paintBytes = 0;
 }
 
-uint8_t MicroGamerCore::twiTransmit(uint8_t data)
+static void twiPaintEnded()
 {
-    twiTransmit(&data, 1);
+  twiStats.frames++;
+  twiStats.lastFrameBytes = paintBytes;
+  twiStats.lastFrameStart = paintStart;
+  twiStats.lastFrameEnd = micros();
 }
 
-uint8_t MicroGamerCore::twiEndTransmission()
+static void twiStartTransaction(uint8_t state, uint8_t control)
 {
-  TWI_DEVICE->TASKS_STOP = 0x1UL;
-  while(!TWI_DEVICE->EVENTS_STOPPED);
-  TWI_DEVICE->EVENTS_STOPPED = 0x0UL;
+  twiState = state;
+  twiControl = control;
+  twiControlSent = false;
+  twiStopping = false;
+  twiFailed = false;
+  twiTransactionStart = micros();
+
+  TWI_DEVICE->ADDRESS = SSD1306_I2C_ADDRESS;
+  TWI_DEVICE->SHORTS = 0x0UL;
+  TWI_DEVICE->TASKS_RESUME = 0x1UL;
+  TWI_DEVICE->TASKS_STARTTX = 0x1UL;
+  TWI_DEVICE->TXD = twiNextByte();
+  twiCountByte();
+}
 
-  if (TWI_DEVICE->EVENTS_ERROR)
-  {
-    TWI_DEVICE->EVENTS_ERROR = 0x0UL;
+// Start the next transaction, if there is anything left to send.
+// Called with the TWI interrupt masked.
+static void twiStartNext()
+{
+  twiHeaderLength = 0;
+  twiHeaderIndex = 0;
+  twiPaintLast = false;
+
+  if (paintState == PAINT_WINDOW_ADDRESS) {
+    // set the start line of the paint with its first window, and the
+    // column and page address range of the next window, after any queued
+    // commands
+    if (paintWindowIndex == 0 && paintStartLine >= 0) {
+      twiHeader[twiHeaderLength++] = SSD1306_SETSTARTLINE |
+                                      (paintStartLine & 63);
+    }
+    if (paintWindowIndex < paintWindowCount) {
+      const DisplayWindow *window = &paintWindowList[paintWindowIndex];
+
+      twiHeader[twiHeaderLength++] = SSD1306_COLUMNADDR;
+      twiHeader[twiHeaderLength++] = window->firstColumn;
+      twiHeader[twiHeaderLength++] = window->lastColumn;
+      twiHeader[twiHeaderLength++] = SSD1306_PAGEADDR;
+      twiHeader[twiHeaderLength++] = window->firstPage;
+      twiHeader[twiHeaderLength++] = window->lastPage;
+      paintState = PAINT_WINDOW_DATA;
+    }
+    else {
+      // only the start line to send
+      paintState = PAINT_IDLE;
+      twiPaintLast = true;
+    }
+  }
 
-    uint32_t error = TWI_DEVICE->ERRORSRC;
+  if (twiHeaderLength != 0 || commandQueueTail != commandQueueHead) {
+    twiStartTransaction(TWI_COMMANDS, 0x00); // Co = 0, D/C = 0
+  }
+  else if (paintState == PAINT_WINDOW_DATA) {
+    const DisplayWindow *window = &paintWindowList[paintWindowIndex];
 
-    TWI_DEVICE->ERRORSRC = error;
+    twiTxData = paintImage + (window->firstPage * WIDTH) + window->firstColumn;
+    twiRowLength = window->lastColumn - window->firstColumn + 1;
+    twiRowLeft = twiRowLength;
+    twiByteToSend = twiRowLength * (window->lastPage - window->firstPage + 1);
+    paintAddressRetries = 0;
 
-    if (error == TWI_ERRORSRC_ANACK_Msk)
-    {
-      return 2;
+    if (++paintWindowIndex < paintWindowCount) {
+      paintState = PAINT_WINDOW_ADDRESS;
     }
-    else if (error == TWI_ERRORSRC_DNACK_Msk)
-    {
-      return 3;
+    else {
+      paintState = PAINT_IDLE;
+      twiPaintLast = true;
     }
-    else
-    {
-      return 4;
+    twiStartTransaction(TWI_DATA, 0x40); // Co = 0, D/C = 1
+  }
+  else {
+    twiState = TWI_IDLE;
+    NVIC_DisableIRQ(TWI_IRQn);
+    if (transferCompleteCallback != NULL) {
+      (*transferCompleteCallback)();
     }
   }
+}
 
-  return 0;
+// Start sending if the handler is idle
+static void twiKick()
+{
+  noInterrupts();
+  if (twiState == TWI_IDLE) {
+    NVIC_ClearPendingIRQ(TWI_IRQn);
+    NVIC_EnableIRQ(TWI_IRQn);
+    twiStartNext();
+  }
+  interrupts();
 }
 
 extern "C" {
 
 void SPI1_TWI1_IRQHandler(void)
 {
+  twiStats.interrupts++;
 
   if(TWI_DEVICE->EVENTS_TXDSENT)
   {
     TWI_DEVICE->EVENTS_TXDSENT = 0;
-    if(twiByteToSend != 0)
+    int data = twiNextByte();
+    if(data >= 0)
     {
-      TWI_DEVICE->TXD = *twiTxData++;
-      twiByteToSend--;
+      TWI_DEVICE->TXD = data;
+      twiCountByte();
     }
     else
     {
@@ -353,8 +486,51 @@ void SPI1_TWI1_IRQHandler(void)
   if(TWI_DEVICE->EVENTS_STOPPED)
   {
     TWI_DEVICE->EVENTS_STOPPED = 0;
-    twiInProgress = false;
-    NVIC_DisableIRQ(TWI_IRQn);
+    twiAccountBusTime(micros());
+    bool paintDone = twiPaintLast;
+    bool paintFailed = false;
+    if(twiState == TWI_COMMANDS && twiFailed && twiHeaderLength != 0)
+    {
+      // the address of the window may not have been set, so its data can't
+      // be sent yet: send the address again, or give up on the paint
+      if(++paintAddressRetries <= PAINT_ADDRESS_RETRIES)
+      {
+        paintState = PAINT_WINDOW_ADDRESS;
+        paintDone = false;
+      }
+      else
+      {
+        paintState = PAINT_IDLE;
+        paintDone = true;
+        paintFailed = true;
+      }
+    }
+    if(paintDone)
+    {
+      if(!paintFailed)
+      {
+        twiPaintEnded();
+      }
+      if(queuedPaintImage != NULL)
+      {
+        twiPaintStarted();
+        // go on with the next frame right away
+        paintImage = queuedPaintImage;
+        memcpy(paintWindowList, queuedWindowList,
+               queuedWindowCount * sizeof(DisplayWindow));
+        paintWindowCount = queuedWindowCount;
+        paintStartLine = queuedStartLine;
+        paintWindowIndex = 0;
+        paintAddressRetries = 0;
+        paintState = PAINT_WINDOW_ADDRESS;
+        queuedPaintImage = NULL;
+      }
+      else
+      {
+        twiInProgress = false;
+      }
+    }
+    twiStartNext();
   }
 
   if(TWI_DEVICE->EVENTS_RXDREADY)
@@ -364,9 +540,27 @@ void SPI1_TWI1_IRQHandler(void)
 
   if(TWI_DEVICE->EVENTS_ERROR)
   {
+    // give up on the rest of this transaction
     TWI_DEVICE->EVENTS_ERROR = 0;
-    twiInProgress = false;
-    NVIC_DisableIRQ(TWI_IRQn);
+
+    uint32_t error = TWI_DEVICE->ERRORSRC;
+
+    TWI_DEVICE->ERRORSRC = error;
+    if(error & TWI_ERRORSRC_ANACK_Msk)
+    {
+      twiStats.addressNacks++;
+    }
+    else if(error & TWI_ERRORSRC_DNACK_Msk)
+    {
+      twiStats.dataNacks++;
+    }
+    else
+    {
+      twiStats.otherErrors++;
+    }
+    twiStopping = true;
+    twiFailed = true;
+    TWI_DEVICE->TASKS_STOP = 1;
   }
 }
 
@@ -413,19 +607,69 @@ uint8_t MicroGamerCore::height() { return HEIGHT; }
 
 void MicroGamerCore::paintScreen(const uint8_t *image)
 {
-  waitEndOfPaintScreen();
+  DisplayWindow window = { 0, WIDTH - 1, 0, (HEIGHT / 8) - 1 };
+
+  paintWindows(image, &window, 1);
+}
+
+void MicroGamerCore::paintWindows(const uint8_t *image,
+                                  const DisplayWindow *windows, uint8_t count,
+                                  int8_t startLine)
+{
+  // only one paint can wait for the one in progress
+  while (queuedPaintImage != NULL) {
+    idle();
+  }
+
+  if (count == 0 && startLine < 0) {
+    return;
+  }
+
+  noInterrupts();
+  if (twiInProgress) {
+    memcpy(queuedWindowList, windows, count * sizeof(DisplayWindow));
+    queuedWindowCount = count;
+    queuedStartLine = startLine;
+    queuedPaintImage = image;
+  }
+  else {
+    paintImage = image;
+    memcpy(paintWindowList, windows, count * sizeof(DisplayWindow));
+    paintWindowCount = count;
+    paintStartLine = startLine;
+    paintWindowIndex = 0;
+    paintAddressRetries = 0;
+    paintState = PAINT_WINDOW_ADDRESS;
+    twiInProgress = true;
+    twiPaintStarted();
+  }
+  interrupts();
+
+  twiKick();
+}
+
+bool MicroGamerCore::cancelQueuedPaint()
+{
+  bool cancelled;
 
-  sendLCDCommand(SSD1306_COLUMNADDR);
-  sendLCDCommand(0);   // Column start address (0 = reset)
-  sendLCDCommand(WIDTH-1); // Column end address (127 = reset)
+  noInterrupts();
+  cancelled = queuedPaintImage != NULL;
+  queuedPaintImage = NULL;
+  interrupts();
 
-  sendLCDCommand(SSD1306_PAGEADDR);
-  sendLCDCommand(0); // Page start address (0 = reset)
-  sendLCDCommand(7); // Page end address
+  return cancelled;
+}
+
+bool MicroGamerCore::paintImageInUse(const uint8_t *image)
+{
+  bool inUse;
+
+  noInterrupts();
+  inUse = twiInProgress &&
+          (image == paintImage || image == queuedPaintImage);
+  interrupts();
 
-  twiBeginTransmission(SSD1306_I2C_ADDRESS);
-  twiTransmit(0x40);
-  twiTransmitAsync(image, SSD1306_LCDWIDTH*SSD1306_LCDHEIGHT/8);
+  return inUse;
 }
 
 bool MicroGamerCore::paintScreenInProgress()
@@ -435,42 +679,89 @@ bool MicroGamerCore::paintScreenInProgress()
 
 void MicroGamerCore::waitEndOfPaintScreen()
 {
-  while (twiInProgress) {
-    idle();
+  if (twiInProgress) {
+    unsigned long waitStart = micros();
+
+    while (twiInProgress) {
+      idle();
+    }
+    twiStats.waitMicros += micros() - waitStart;
   }
 }
 
 void MicroGamerCore::sendLCDCommand(uint8_t command)
 {
-  uint8_t data[2] = {0x00,  // Co = 0, D/C = 0
-                     command};
-  twiBeginTransmission(SSD1306_I2C_ADDRESS);
-  twiTransmit(data, 2);
-  twiEndTransmission();
+  sendLCDCommands(&command, 1);
 }
 
 void MicroGamerCore::sendLCDCommand(uint8_t command,
                                   uint8_t command2)
 {
-  uint8_t data[3] = {0x00,  // Co = 0, D/C = 0
-                     command,
-                     command2};
-  twiBeginTransmission(SSD1306_I2C_ADDRESS);
-  twiTransmit(data, 3);
-  twiEndTransmission();
+  uint8_t commands[2] = {command, command2};
+
+  sendLCDCommands(commands, 2);
 }
 
 void MicroGamerCore::sendLCDCommand(uint8_t command,
                                   uint8_t command2,
                                   uint8_t command3)
 {
-  uint8_t data[4] = {0x00,  // Co = 0, D/C = 0
-                     command,
-                     command2,
-                     command3};
-  twiBeginTransmission(SSD1306_I2C_ADDRESS);
-  twiTransmit(data, 4);
-  twiEndTransmission();
+  uint8_t commands[3] = {command, command2, command3};
+
+  sendLCDCommands(commands, 3);
+}
+
+void MicroGamerCore::sendLCDCommands(const uint8_t *commands, uint8_t count)
+{
+  while (count != 0) {
+    uint8_t chunk = min(count, COMMAND_QUEUE_SIZE - 1);
+    uint8_t head = commandQueueHead;
+
+    // wait for room for the whole sequence and make it visible to the
+    // handler at once, so that a multi-byte command is never split by
+    // window address commands
+    while (((commandQueueTail - head - 1) & COMMAND_QUEUE_MASK) < chunk) {
+      twiKick();
+      idle();
+    }
+
+    count -= chunk;
+    while (chunk--) {
+      commandQueue[head] = pgm_read_byte(commands++);
+      head = (head + 1) & COMMAND_QUEUE_MASK;
+    }
+    commandQueueHead = head;
+  }
+
+  twiKick();
+}
+
+void MicroGamerCore::setTransferCompleteCallback(void (*callback)())
+{
+  transferCompleteCallback = callback;
+}
+
+bool MicroGamerCore::transferInProgress()
+{
+  return twiState != TWI_IDLE || commandQueueTail != commandQueueHead;
+}
+
+void MicroGamerCore::getDisplayStats(DisplayStats *stats)
+{
+  noInterrupts();
+  twiAccountBusTime(micros());
+  *stats = twiStats;
+  interrupts();
+}
+
+void MicroGamerCore::resetDisplayStats()
+{
+  noInterrupts();
+  memset(&twiStats, 0, sizeof(twiStats));
+  busBusyMicros = 0;
+  busLoadStart = micros();
+  twiTransactionStart = busLoadStart;
+  interrupts();
 }
 
 // invert the display or set to normal
@@ -499,6 +790,40 @@ void MicroGamerCore::flipHorizontal(bool flipped)
   sendLCDCommand(flipped ? OLED_HORIZ_NORMAL: OLED_HORIZ_FLIPPED);
 }
 
+void MicroGamerCore::setStartLine(uint8_t line)
+{
+  sendLCDCommand(SSD1306_SETSTARTLINE | (line & 63));
+}
+
+void MicroGamerCore::setDisplayOffset(uint8_t offset)
+{
+  sendLCDCommand(SSD1306_SETDISPLAYOFFSET, offset & 63);
+}
+
+void MicroGamerCore::startHorizontalScroll(bool left, uint8_t firstPage,
+                                           uint8_t lastPage, uint8_t interval)
+{
+  // the scroll has to be stopped before it's set up again
+  const uint8_t commands[] = {
+    SSD1306_DEACTIVATE_SCROLL,
+    (uint8_t)(left ? SSD1306_LEFT_HORIZONTAL_SCROLL :
+                     SSD1306_RIGHT_HORIZONTAL_SCROLL),
+    0x00, // dummy byte
+    (uint8_t)(firstPage & 7),
+    (uint8_t)(interval & 7),
+    (uint8_t)(lastPage & 7),
+    0x00, 0xFF, // dummy bytes
+    SSD1306_ACTIVATE_SCROLL
+  };
+
+  sendLCDCommands(commands, sizeof(commands));
+}
+
+void MicroGamerCore::stopHorizontalScroll()
+{
+  sendLCDCommand(SSD1306_DEACTIVATE_SCROLL);
+}
+
 /* Buttons */
 
 uint8_t MicroGamerCore::buttonsState()
@@ -51,6 +51,55 @@
 #define COLUMN_ADDRESS_END (WIDTH - 1) & 127   // 128 pixels wide
 #define PAGE_ADDRESS_END ((HEIGHT/8)-1) & 7    // 8 pages high
 
+/** \brief
+ * A rectangular area of the display, given in columns and pages.
+ *
+ * \details
+ * A page is a horizontal band of the display, 8 pixels high. Page 0 is the
+ * top of the display. Each byte of the display buffer represents one column
+ * of one page. Both the first and last column and page are included in the
+ * area.
+ *
+ * \see MicroGamerCore::paintWindows()
+ */
+struct DisplayWindow
+{
+  uint8_t firstColumn; /**< The leftmost column of the area */
+  uint8_t lastColumn;  /**< The rightmost column of the area */
+  uint8_t firstPage;   /**< The top page of the area */
+  uint8_t lastPage;    /**< The bottom page of the area */
+};
+
+/** \brief
+ * Statistics of the transfers to the display.
+ *
+ * \details
+ * The counters are updated by the TWI interrupt handler for every transfer
+ * and can be read at any time with `MicroGamerCore::getDisplayStats()`.
+ * Times are given in microseconds, as returned by `micros()`. A frame is
+ * the transfer of the image areas given to one `paintScreen()` or
+ * `paintWindows()` call. The bytes include the control bytes and any
+ * commands sent while the frame is sent. Each error stops the transaction it
+ * happens in. The bus utilisation is the part of the time a transaction was
+ * in progress, measured over periods of at least a quarter of a second.
+ *
+ * \see MicroGamerCore::getDisplayStats() MicroGamerCore::resetDisplayStats()
+ */
+struct DisplayStats
+{
+  unsigned long frames;         /**< Frames completely sent */
+  uint16_t lastFrameBytes;      /**< Bytes sent for the last frame */
+  unsigned long lastFrameStart; /**< Start time of the last frame */
+  unsigned long lastFrameEnd;   /**< End time of the last frame */
+  unsigned long totalBytes;     /**< Bytes sent for everything */
+  unsigned long interrupts;     /**< TWI interrupts handled */
+  uint16_t addressNacks;        /**< Address not acknowledged */
+  uint16_t dataNacks;           /**< Data byte not acknowledged */
+  uint16_t otherErrors;         /**< Other TWI errors */
+  unsigned long waitMicros;     /**< Time blocked waiting for a paint */
+  uint8_t busLoad;              /**< Recent bus utilisation in percent */
+};
+
 #define BUTTON_A_PIN (5)
 #define BUTTON_B_PIN (11)
 #define BUTTON_X_PIN (0)
@@ -177,14 +226,80 @@ class MicroGamerCore
      * the bottom right. The size of the array must exactly match the number of
      * pixels in the entire display.
      *
+     * If a transfer is already in progress, this one is queued the same way
+     * as for `paintWindows()`.
+     *
      * \see paintScreenInProgress() waitEndOfPaintScreen()
      */
     void static paintScreen(const uint8_t *image);
 
+    /** \brief
+     * Asynchronously paints parts of an image directly to the display.
+     *
+     * \param image A byte array representing the entire contents of the
+     * display, in the same format as for `paintScreen()`.
+     * \param windows An array of the areas of the image to be sent.
+     * \param count The number of areas in the `windows` array. It can't be
+     * more than the number of pages of the display (8).
+     * \param startLine The display start line to set when this transfer
+     * starts, from 0 to 63, or -1 to leave it as it is (optional; defaults
+     * to -1).
+     *
+     * \details
+     * Only the bytes of the image inside the given areas are written to the
+     * display. The rest of the display keeps its current contents. Each area
+     * is sent as a command sequence setting the display's column and page
+     * address range, followed by the data bytes for that range.
+     *
+     * The areas are copied so the `windows` array doesn't have to remain
+     * valid after the call. The image must remain valid until the transfer
+     * is complete.
+     *
+     * If a transfer is already in progress, the new one is queued and starts
+     * as soon as the current one is complete. Only one transfer can be
+     * queued. If there already is one, this function waits for it to start.
+     *
+     * The start line is sent ahead of the first area, so unlike
+     * `setStartLine()` it doesn't move the image of a transfer still in
+     * progress. With a start line, `count` can be 0 to only set the start
+     * line once the transfers before it are complete.
+     *
+     * \see paintScreen() paintScreenInProgress() waitEndOfPaintScreen()
+     * cancelQueuedPaint() paintImageInUse()
+     */
+    void static paintWindows(const uint8_t *image,
+                             const DisplayWindow *windows, uint8_t count,
+                             int8_t startLine = -1);
+
+    /** \brief
+     * Cancel the queued screen transfer.
+     *
+     * \return True if a queued transfer was cancelled, false if there was
+     * none or it had already started.
+     *
+     * \details
+     * A transfer queued by `paintWindows()` or `paintScreen()` that hasn't
+     * started yet won't be sent.
+     *
+     * \see paintWindows()
+     */
+    bool static cancelQueuedPaint();
+
+    /** \brief
+     * Test if an image is being sent or queued to be sent to the display.
+     *
+     * \param image The image passed to `paintScreen()` or `paintWindows()`.
+     *
+     * \return True if the image is still needed by a screen transfer.
+     *
+     * \see paintWindows() paintScreenInProgress()
+     */
+    bool static paintImageInUse(const uint8_t *image);
+
     /** \brief
      * Paint screen in progress.
      *
-     * \return True if a screen transfer is in progress.
+     * \return True if a screen transfer is in progress or queued.
      *
      * \see paintScreen() waitEndOfPaintScreen()
      */
@@ -271,19 +386,98 @@ class MicroGamerCore
      */
     void static flipHorizontal(bool flipped);
 
+    /** \brief
+     * Set the display RAM row shown at the top of the display.
+     *
+     * \param line The display RAM row, from 0 to 63, to show on the top row
+     * of the display.
+     *
+     * \details
+     * The display shows the display RAM starting at this row, wrapping
+     * around to row 0 after row 63. Changing the start line scrolls the
+     * whole image vertically without sending any display data.
+     *
+     * \note
+     * `MicroGamerBase::scrollVertical()` keeps track of the start line for
+     * the frame buffer and should be used instead in most cases.
+     *
+     * \see setDisplayOffset() MicroGamerBase::scrollVertical()
+     */
+    void static setStartLine(uint8_t line);
+
+    /** \brief
+     * Set the vertical offset of the display.
+     *
+     * \param offset The number of rows, from 0 to 63, the image is moved up,
+     * wrapping around at the bottom of the display.
+     *
+     * \details
+     * The offset has the same effect as the start line set with
+     * `setStartLine()` but is set independently. The two add up, so one can
+     * be used for scrolling and the other one for effects such as a screen
+     * shake.
+     *
+     * \see setStartLine() MicroGamerBase::setShake()
+     */
+    void static setDisplayOffset(uint8_t offset);
+
+    /** \brief
+     * Start scrolling a band of the display horizontally.
+     *
+     * \param left `true` to scroll to the left, `false` to scroll to the
+     * right.
+     * \param firstPage The first page (8 pixel high row) to scroll.
+     * \param lastPage The last page to scroll.
+     * \param interval The time between each 1 pixel step, in display frames:
+     * 0 for 5 frames, 1 for 64, 2 for 128, 3 for 256, 4 for 3, 5 for 4, 6 for
+     * 25 and 7 for 2.
+     *
+     * \details
+     * The display keeps scrolling the pages, wrapping around at the edges,
+     * until `stopHorizontalScroll()` is called. No display data has to be
+     * sent while it scrolls.
+     *
+     * The display RAM of the pages shouldn't be written to while they are
+     * scrolling. Since the scrolling moves the content of the display RAM,
+     * its content is unknown once the scrolling is stopped.
+     *
+     * \see stopHorizontalScroll()
+     */
+    void static startHorizontalScroll(bool left, uint8_t firstPage,
+                                      uint8_t lastPage, uint8_t interval);
+
+    /** \brief
+     * Stop the scrolling started by `startHorizontalScroll()`.
+     *
+     * \details
+     * The scrolled pages have to be sent to the display again, for instance
+     * by calling `MicroGamerBase::resendPages()` before the next
+     * `display()`.
+     *
+     * \see startHorizontalScroll() MicroGamerBase::resendPages()
+     */
+    void static stopHorizontalScroll();
+
     /** \brief
      * Send a single command byte to the display.
      *
      * \param command The command byte to send to the display.
      *
      * \details
-     * The display will be set to command mode then the specified command
-     * byte will be sent. The display will then be set to data mode.
-     * Multi-byte commands can be sent by calling this function multiple times.
+     * The command is added to a queue and the function returns immediately.
+     * Queued commands are sent by the TWI interrupt handler, in order, ahead
+     * of any display data that hasn't been sent yet. All the commands queued
+     * at the time are sent together in a single transaction.
+     *
+     * Multi-byte commands should be sent with a single call, using one of the
+     * overloads taking more than one byte or `sendLCDCommands()`. They will
+     * then never be split by the commands setting up a display data transfer.
      *
      * \note
      * Sending improper commands to the display can place it into invalid or
      * unexpected states, possibly even causing physical damage.
+     *
+     * \see sendLCDCommands() setTransferCompleteCallback()
      */
     void static sendLCDCommand(uint8_t command);
 
@@ -294,6 +488,67 @@ class MicroGamerCore
                                uint8_t command2,
                                uint8_t command3);
 
+    /** \brief
+     * Send a sequence of command bytes to the display.
+     *
+     * \param commands An array of command bytes.
+     * \param count The number of bytes in the array.
+     *
+     * \details
+     * The commands are queued the same way as for `sendLCDCommand()`. If the
+     * queue doesn't have room for the whole sequence, this function waits for
+     * the interrupt handler to make room. Sequences longer than the queue
+     * (63 bytes) are queued in parts.
+     *
+     * \see sendLCDCommand()
+     */
+    void static sendLCDCommands(const uint8_t *commands, uint8_t count);
+
+    /** \brief
+     * Set a function to be called when all display transfers are complete.
+     *
+     * \param callback The function to call, or `NULL` for none.
+     *
+     * \details
+     * The function is called each time the queued commands and display data
+     * have all been sent. It's called from the TWI interrupt handler, so it
+     * should be short and must not wait for anything.
+     *
+     * \see transferInProgress() sendLCDCommand() paintScreen()
+     */
+    void static setTransferCompleteCallback(void (*callback)());
+
+    /** \brief
+     * Display transfer in progress.
+     *
+     * \return True if there are commands or display data not sent yet.
+     *
+     * \see setTransferCompleteCallback() paintScreenInProgress()
+     */
+    bool static transferInProgress();
+
+    /** \brief
+     * Get the statistics of the transfers to the display.
+     *
+     * \param stats The structure to copy the statistics to.
+     *
+     * \details
+     * The statistics are always kept, at the cost of a few counter updates
+     * for each transaction on the bus. They can be used to tell whether a
+     * sketch is slowed down by drawing or by sending the frames, for
+     * instance by comparing `busLoad` with `MicroGamerBase::cpuLoad()`.
+     *
+     * \see resetDisplayStats() DisplayStats
+     */
+    void static getDisplayStats(DisplayStats *stats);
+
+    /** \brief
+     * Set all the statistics of the transfers to the display back to 0.
+     *
+     * \see getDisplayStats()
+     */
+    void static resetDisplayStats();
+
     /** \brief
      * Initialize the MicroGamer's hardware.
      *
@@ -330,15 +585,6 @@ class MicroGamerCore
     void static bootPins();
     void static bootPowerSaving();
     void static bootTWI();
-
-    void static twiBeginTransmission(uint8_t address);
-    uint8_t static twiTransmit(const uint8_t data[],
-                               size_t quantity);
-
-    void static twiTransmitAsync(const uint8_t data[],
-                                    size_t quantity);
-    uint8_t static twiTransmit(uint8_t data);
-    uint8_t static twiEndTransmission();
 };
 
 #endif
@@ -6,30 +6,255 @@
 
 #include "Sprites.h"
 
+// Each byte with its bits in reverse order, for flipping sprites
+static const uint8_t reversedBits[256] PROGMEM = {
+  0x00, 0x80, 0x40, 0xC0, 0x20, 0xA0, 0x60, 0xE0,
+  0x10, 0x90, 0x50, 0xD0, 0x30, 0xB0, 0x70, 0xF0,
+  0x08, 0x88, 0x48, 0xC8, 0x28, 0xA8, 0x68, 0xE8,
+  0x18, 0x98, 0x58, 0xD8, 0x38, 0xB8, 0x78, 0xF8,
+  0x04, 0x84, 0x44, 0xC4, 0x24, 0xA4, 0x64, 0xE4,
+  0x14, 0x94, 0x54, 0xD4, 0x34, 0xB4, 0x74, 0xF4,
+  0x0C, 0x8C, 0x4C, 0xCC, 0x2C, 0xAC, 0x6C, 0xEC,
+  0x1C, 0x9C, 0x5C, 0xDC, 0x3C, 0xBC, 0x7C, 0xFC,
+  0x02, 0x82, 0x42, 0xC2, 0x22, 0xA2, 0x62, 0xE2,
+  0x12, 0x92, 0x52, 0xD2, 0x32, 0xB2, 0x72, 0xF2,
+  0x0A, 0x8A, 0x4A, 0xCA, 0x2A, 0xAA, 0x6A, 0xEA,
+  0x1A, 0x9A, 0x5A, 0xDA, 0x3A, 0xBA, 0x7A, 0xFA,
+  0x06, 0x86, 0x46, 0xC6, 0x26, 0xA6, 0x66, 0xE6,
+  0x16, 0x96, 0x56, 0xD6, 0x36, 0xB6, 0x76, 0xF6,
+  0x0E, 0x8E, 0x4E, 0xCE, 0x2E, 0xAE, 0x6E, 0xEE,
+  0x1E, 0x9E, 0x5E, 0xDE, 0x3E, 0xBE, 0x7E, 0xFE,
+  0x01, 0x81, 0x41, 0xC1, 0x21, 0xA1, 0x61, 0xE1,
+  0x11, 0x91, 0x51, 0xD1, 0x31, 0xB1, 0x71, 0xF1,
+  0x09, 0x89, 0x49, 0xC9, 0x29, 0xA9, 0x69, 0xE9,
+  0x19, 0x99, 0x59, 0xD9, 0x39, 0xB9, 0x79, 0xF9,
+  0x05, 0x85, 0x45, 0xC5, 0x25, 0xA5, 0x65, 0xE5,
+  0x15, 0x95, 0x55, 0xD5, 0x35, 0xB5, 0x75, 0xF5,
+  0x0D, 0x8D, 0x4D, 0xCD, 0x2D, 0xAD, 0x6D, 0xED,
+  0x1D, 0x9D, 0x5D, 0xDD, 0x3D, 0xBD, 0x7D, 0xFD,
+  0x03, 0x83, 0x43, 0xC3, 0x23, 0xA3, 0x63, 0xE3,
+  0x13, 0x93, 0x53, 0xD3, 0x33, 0xB3, 0x73, 0xF3,
+  0x0B, 0x8B, 0x4B, 0xCB, 0x2B, 0xAB, 0x6B, 0xEB,
+  0x1B, 0x9B, 0x5B, 0xDB, 0x3B, 0xBB, 0x7B, 0xFB,
+  0x07, 0x87, 0x47, 0xC7, 0x27, 0xA7, 0x67, 0xE7,
+  0x17, 0x97, 0x57, 0xD7, 0x37, 0xB7, 0x77, 0xF7,
+  0x0F, 0x8F, 0x4F, 0xCF, 0x2F, 0xAF, 0x6F, 0xEF,
+  0x1F, 0x9F, 0x5F, 0xDF, 0x3F, 0xBF, 0x7F, 0xFF
+};
+
+// The byte of a frame's column on a page, or 0 outside the frame
+static inline uint8_t frameByte(const uint8_t *plane, uint8_t stride,
+                                uint8_t w, uint8_t pages,
+                                int16_t column, int16_t page)
+{
+  if (column < 0 || column >= w || page < 0 || page >= pages)
+    return 0;
+  return pgm_read_byte(plane + ((page * w) + column) * stride);
+}
+
+// Transpose 8 columns of 8 pixels, so that bit j of column i becomes bit i
+// of column j. The columns are handled as two words of 4, with the bits
+// swapped in blocks of 1, 2 and 4.
+static inline void transposeBlock(uint8_t *columns)
+{
+  uint32_t lo = columns[0] | (columns[1] << 8) | (columns[2] << 16) |
+                ((uint32_t)columns[3] << 24);
+  uint32_t hi = columns[4] | (columns[5] << 8) | (columns[6] << 16) |
+                ((uint32_t)columns[7] << 24);
+  uint32_t t;
+
+  t = (hi ^ (hi >> 7)) & 0x00AA00AA;
+  hi = hi ^ t ^ (t << 7);
+  t = (lo ^ (lo >> 7)) & 0x00AA00AA;
+  lo = lo ^ t ^ (t << 7);
+  t = (hi ^ (hi >> 14)) & 0x0000CCCC;
+  hi = hi ^ t ^ (t << 14);
+  t = (lo ^ (lo >> 14)) & 0x0000CCCC;
+  lo = lo ^ t ^ (t << 14);
+  t = (hi & 0xF0F0F0F0) | ((lo >> 4) & 0x0F0F0F0F);
+  lo = ((hi << 4) & 0xF0F0F0F0) | (lo & 0x0F0F0F0F);
+  hi = t;
+
+  for (uint8_t i = 0; i < 4; i++) {
+    columns[i] = lo >> (i * 8);
+    columns[i + 4] = hi >> (i * 8);
+  }
+}
+
+// Write the column of the untransformed frame at base, scaled with the
+// expanded nibbles for the scale, to the columns of dst it covers, dst being
+// columns first to end - 1 of the result
+static inline void transformedColumn(uint8_t *dst, int16_t base, uint8_t bits,
+                                     uint8_t scale, const uint16_t *expand,
+                                     uint8_t offset, int16_t first,
+                                     int16_t end)
+{
+  if (scale == 1) {
+    dst[base - first] = bits;
+    return;
+  }
+
+  uint8_t scaled = (pgm_read_word(expand + (bits & 0x0F)) |
+                    ((uint32_t)pgm_read_word(expand + (bits >> 4)) << (4 * scale)))
+                   >> offset;
+  int16_t column = base * scale;
+
+  for (uint8_t i = 0; i < scale; i++, column++) {
+    if (column >= first && column < end)
+      dst[column - first] = scaled;
+  }
+}
+
+// Work out columns first to end - 1 of a page row of a transformed frame of
+// a sprite's image or mask, with the bytes stride apart in plane. A quarter
+// turn is the frame transposed and then mirrored.
+static void transformBand(uint8_t *dst, const uint8_t *plane, uint8_t stride,
+                          uint8_t w, uint8_t h, uint8_t transform,
+                          uint8_t scale, const uint16_t *expand,
+                          uint8_t band, int16_t first, int16_t end)
+{
+  uint8_t pages = (h + 7) / 8;
+  bool rotate = transform & SPRITE_ROTATE_90;
+  bool mirror = ((transform & SPRITE_MIRROR) != 0) != rotate;
+  bool flip = transform & SPRITE_FLIP;
+  uint8_t height = rotate ? w : h;
+
+  // the row of the transformed frame at the top of the band, before it's
+  // scaled, and how far into that row's pixels the band starts
+  uint8_t row = (band * 8) / scale;
+  uint8_t offset = (band * 8) - (row * scale);
+  uint8_t valid = (height - row >= 8) ? 0xFF : (1 << (height - row)) - 1;
+  int16_t firstColumn = first / scale;
+  int16_t lastColumn = (end - 1) / scale;
+
+  if (!rotate) {
+    // Each column is 8 rows of the frame's column, read from the two pages
+    // they're across. Flipped, they're the rows counted up from the bottom,
+    // reversed.
+    int16_t top = flip ? h - 8 - row : row;
+    int16_t page = (top >= 0) ? top / 8 : -1;
+    uint8_t shift = top - (page * 8);
+    int16_t step = mirror ? -stride : stride;
+    int16_t source = mirror ? w - 1 - firstColumn : firstColumn;
+    const uint8_t *upper = (page >= 0) ?
+                           plane + ((page * w) + source) * stride : NULL;
+    const uint8_t *lower = (shift != 0 && page + 1 < pages) ?
+                           plane + (((page + 1) * w) + source) * stride : NULL;
+
+    for (int16_t column = firstColumn; column <= lastColumn; column++) {
+      uint16_t bits = 0;
+
+      if (upper != NULL) {
+        bits = pgm_read_byte(upper);
+        upper += step;
+      }
+      if (lower != NULL) {
+        bits |= pgm_read_byte(lower) << 8;
+        lower += step;
+      }
+      bits >>= shift;
+      if (flip)
+        bits = pgm_read_byte(reversedBits + (bits & 0xFF));
+
+      transformedColumn(dst, column, bits & valid, scale, expand, offset,
+                        first, end);
+    }
+    return;
+  }
+
+  // Rotated, the 8 rows are 8 columns of the frame, and each column is a
+  // row of the frame. Each page of those columns is transposed to give the
+  // columns of its 8 rows.
+  int16_t lowRow = mirror ? h - 1 - lastColumn : firstColumn;
+  int16_t highRow = mirror ? h - 1 - firstColumn : lastColumn;
+
+  for (int16_t page = lowRow / 8; page <= highRow / 8; page++) {
+    uint8_t block[8];
+
+    for (uint8_t i = 0; i < 8; i++) {
+      int16_t source = flip ? w - 1 - row - i : row + i;
+      block[i] = frameByte(plane, stride, w, pages, source, page);
+    }
+    transposeBlock(block);
+
+    for (uint8_t i = 0; i < 8; i++) {
+      int16_t source = (page * 8) + i;
+
+      if (source < lowRow || source > highRow)
+        continue;
+
+      int16_t column = mirror ? h - 1 - source : source;
+      transformedColumn(dst, column, block[i] & valid, scale, expand, offset,
+                        first, end);
+    }
+  }
+}
+
+template<uint8_t Mode>
+void Sprites::drawFrame(int16_t x, int16_t y,
+                        const uint8_t *bitmap, uint8_t frame,
+                        const uint8_t *mask, uint8_t mask_frame)
+{
+  if (bitmap == NULL)
+    return;
+
+  uint8_t width = pgm_read_byte(bitmap);
+  uint8_t height = pgm_read_byte(bitmap + 1);
+  uint16_t frame_size = width * ((height + 7) / 8);
+
+  bitmap += 2 + frame * frame_size * (Mode == SPRITE_PLUS_MASK ? 2 : 1);
+  if (Mode == SPRITE_MASKED && mask != NULL) {
+    mask += mask_frame * frame_size;
+  }
+  drawBitmapMode<Mode>(x, y, bitmap, mask, width, height);
+}
+
+// the named draw functions for sprites of other sizes
+template void Sprites::drawFrame<SPRITE_MASKED>(int16_t, int16_t,
+  const uint8_t *, uint8_t, const uint8_t *, uint8_t);
+template void Sprites::drawFrame<SPRITE_OVERWRITE>(int16_t, int16_t,
+  const uint8_t *, uint8_t, const uint8_t *, uint8_t);
+template void Sprites::drawFrame<SPRITE_IS_MASK_ERASE>(int16_t, int16_t,
+  const uint8_t *, uint8_t, const uint8_t *, uint8_t);
+template void Sprites::drawFrame<SPRITE_IS_MASK>(int16_t, int16_t,
+  const uint8_t *, uint8_t, const uint8_t *, uint8_t);
+template void Sprites::drawFrame<SPRITE_PLUS_MASK>(int16_t, int16_t,
+  const uint8_t *, uint8_t, const uint8_t *, uint8_t);
+
 void Sprites::drawExternalMask(int16_t x, int16_t y, const uint8_t *bitmap,
-                               const uint8_t *mask, uint8_t frame, uint8_t mask_frame)
+                               const uint8_t *mask, uint8_t frame, uint8_t mask_frame,
+                               uint8_t transform, uint8_t scale)
 {
-  draw(x, y, bitmap, frame, mask, mask_frame, SPRITE_MASKED);
+  drawTransformed(x, y, bitmap, frame, mask, mask_frame, SPRITE_MASKED,
+                  transform, scale);
 }
 
-void Sprites::drawOverwrite(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame)
+void Sprites::drawOverwrite(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                            uint8_t transform, uint8_t scale)
 {
-  draw(x, y, bitmap, frame, NULL, 0, SPRITE_OVERWRITE);
+  drawTransformed(x, y, bitmap, frame, NULL, 0, SPRITE_OVERWRITE,
+                  transform, scale);
 }
 
-void Sprites::drawErase(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame)
+void Sprites::drawErase(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                        uint8_t transform, uint8_t scale)
 {
-  draw(x, y, bitmap, frame, NULL, 0, SPRITE_IS_MASK_ERASE);
+  drawTransformed(x, y, bitmap, frame, NULL, 0, SPRITE_IS_MASK_ERASE,
+                  transform, scale);
 }
 
-void Sprites::drawSelfMasked(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame)
+void Sprites::drawSelfMasked(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                             uint8_t transform, uint8_t scale)
 {
-  draw(x, y, bitmap, frame, NULL, 0, SPRITE_IS_MASK);
+  drawTransformed(x, y, bitmap, frame, NULL, 0, SPRITE_IS_MASK,
+                  transform, scale);
 }
 
-void Sprites::drawPlusMask(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame)
+void Sprites::drawPlusMask(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                           uint8_t transform, uint8_t scale)
 {
-  draw(x, y, bitmap, frame, NULL, 0, SPRITE_PLUS_MASK);
+  drawTransformed(x, y, bitmap, frame, NULL, 0, SPRITE_PLUS_MASK,
+                  transform, scale);
 }
 
 
@@ -71,286 +296,110 @@ void Sprites::drawBitmap(int16_t x, int16_t y,
                          const uint8_t *bitmap, const uint8_t *mask,
                          uint8_t w, uint8_t h, uint8_t draw_mode)
 {
-  // no need to draw at all of we're offscreen
-  if (x + w <= 0 || x > WIDTH - 1 || y + h <= 0 || y > HEIGHT - 1)
-    return;
-
-  if (bitmap == NULL)
-    return;
-
-  // xOffset technically doesn't need to be 16 bit but the math operations
-  // are measurably faster if it is
-  uint16_t xOffset, ofs;
-  int8_t yOffset = abs(y) % 8;
-  int8_t sRow = y / 8;
-  uint8_t loop_h, start_h, rendered_width;
-
-  if (y < 0 && yOffset > 0) {
-    sRow--;
-    yOffset = 8 - yOffset;
-  }
-
-  // if the left side of the render is offscreen skip those loops
-  if (x < 0) {
-    xOffset = abs(x);
-  } else {
-    xOffset = 0;
-  }
-
-  // if the right side of the render is offscreen skip those loops
-  if (x + w > WIDTH - 1) {
-    rendered_width = ((WIDTH - x) - xOffset);
-  } else {
-    rendered_width = (w - xOffset);
-  }
-
-  // if the top side of the render is offscreen skip those loops
-  if (sRow < -1) {
-    start_h = abs(sRow) - 1;
-  } else {
-    start_h = 0;
-  }
-
-  loop_h = h / 8 + (h % 8 > 0 ? 1 : 0); // divide, then round up
-
-  // if (sRow + loop_h - 1 > (HEIGHT/8)-1)
-  if (sRow + loop_h > (HEIGHT / 8)) {
-    loop_h = (HEIGHT / 8) - sRow;
-  }
-
-  // prepare variables for loops later so we can compare with 0
-  // instead of comparing two variables
-  loop_h -= start_h;
-
-  sRow += start_h;
-  ofs = (sRow * WIDTH) + x + xOffset;
-  uint8_t *bofs = (uint8_t *)bitmap + (start_h * w) + xOffset;
-  uint8_t data;
-
-  uint8_t mul_amt = 1 << yOffset;
-  uint16_t mask_data;
-  uint16_t bitmap_data;
-
   switch (draw_mode) {
     case SPRITE_UNMASKED:
-      // we only want to mask the 8 bits of our own sprite, so we can
-      // calculate the mask before the start of the loop
-      mask_data = ~(0xFF * mul_amt);
-      // really if yOffset = 0 you have a faster case here that could be
-      // optimized
-      for (uint8_t a = 0; a < loop_h; a++) {
-        for (uint8_t iCol = 0; iCol < rendered_width; iCol++) {
-          bitmap_data = pgm_read_byte(bofs) * mul_amt;
-
-          if (sRow >= 0) {
-            data = MicroGamerBase::sBuffer[ofs];
-            data &= (uint8_t)(mask_data);
-            data |= (uint8_t)(bitmap_data);
-            MicroGamerBase::sBuffer[ofs] = data;
-          }
-          if (yOffset != 0 && sRow < 7) {
-            data = MicroGamerBase::sBuffer[ofs + WIDTH];
-            data &= (*((unsigned char *) (&mask_data) + 1));
-            data |= (*((unsigned char *) (&bitmap_data) + 1));
-            MicroGamerBase::sBuffer[ofs + WIDTH] = data;
-          }
-          ofs++;
-          bofs++;
-        }
-        sRow++;
-        bofs += w - rendered_width;
-        ofs += WIDTH - rendered_width;
-      }
+      drawBitmapMode<SPRITE_UNMASKED>(x, y, bitmap, mask, w, h);
       break;
 
     case SPRITE_IS_MASK:
-      for (uint8_t a = 0; a < loop_h; a++) {
-        for (uint8_t iCol = 0; iCol < rendered_width; iCol++) {
-          bitmap_data = pgm_read_byte(bofs) * mul_amt;
-          if (sRow >= 0) {
-            MicroGamerBase::sBuffer[ofs] |= (uint8_t)(bitmap_data);
-          }
-          if (yOffset != 0 && sRow < 7) {
-            MicroGamerBase::sBuffer[ofs + WIDTH] |= (*((unsigned char *) (&bitmap_data) + 1));
-          }
-          ofs++;
-          bofs++;
-        }
-        sRow++;
-        bofs += w - rendered_width;
-        ofs += WIDTH - rendered_width;
-      }
+      drawBitmapMode<SPRITE_IS_MASK>(x, y, bitmap, mask, w, h);
       break;
 
     case SPRITE_IS_MASK_ERASE:
-      for (uint8_t a = 0; a < loop_h; a++) {
-        for (uint8_t iCol = 0; iCol < rendered_width; iCol++) {
-          bitmap_data = pgm_read_byte(bofs) * mul_amt;
-          if (sRow >= 0) {
-            MicroGamerBase::sBuffer[ofs]  &= ~(uint8_t)(bitmap_data);
-          }
-          if (yOffset != 0 && sRow < 7) {
-            MicroGamerBase::sBuffer[ofs + WIDTH] &= ~(*((unsigned char *) (&bitmap_data) + 1));
-          }
-          ofs++;
-          bofs++;
-        }
-        sRow++;
-        bofs += w - rendered_width;
-        ofs += WIDTH - rendered_width;
-      }
+      drawBitmapMode<SPRITE_IS_MASK_ERASE>(x, y, bitmap, mask, w, h);
       break;
 
     case SPRITE_MASKED:
-      uint8_t *mask_ofs;
-      mask_ofs = (uint8_t *)mask + (start_h * w) + xOffset;
-      for (uint8_t a = 0; a < loop_h; a++) {
-        for (uint8_t iCol = 0; iCol < rendered_width; iCol++) {
-          // NOTE: you might think in the yOffset==0 case that this results
-          // in more effort, but in all my testing the compiler was forcing
-          // 16-bit math to happen here anyways, so this isn't actually
-          // compiling to more code than it otherwise would. If the offset
-          // is 0 the high part of the word will just never be used.
-
-          // load data and bit shift
-          // mask needs to be bit flipped
-          mask_data = ~(pgm_read_byte(mask_ofs) * mul_amt);
-          bitmap_data = pgm_read_byte(bofs) * mul_amt;
-
-          if (sRow >= 0) {
-            data = MicroGamerBase::sBuffer[ofs];
-            data &= (uint8_t)(mask_data);
-            data |= (uint8_t)(bitmap_data);
-            MicroGamerBase::sBuffer[ofs] = data;
-          }
-          if (yOffset != 0 && sRow < 7) {
-            data = MicroGamerBase::sBuffer[ofs + WIDTH];
-            data &= (*((unsigned char *) (&mask_data) + 1));
-            data |= (*((unsigned char *) (&bitmap_data) + 1));
-            MicroGamerBase::sBuffer[ofs + WIDTH] = data;
-          }
-          ofs++;
-          mask_ofs++;
-          bofs++;
-        }
-        sRow++;
-        bofs += w - rendered_width;
-        mask_ofs += w - rendered_width;
-        ofs += WIDTH - rendered_width;
-      }
+      drawBitmapMode<SPRITE_MASKED>(x, y, bitmap, mask, w, h);
       break;
 
-
     case SPRITE_PLUS_MASK:
-      // *2 because we use double the bits (mask + bitmap)
-      bofs = (uint8_t *)(bitmap + ((start_h * w) + xOffset) * 2);
-
-      uint8_t xi = rendered_width; // used for x loop below
-      uint8_t yi = loop_h; // used for y loop below
-
-      // asm volatile(
-      //   "push r28\n" // save Y
-      //   "push r29\n"
-      //   "movw r28, %[buffer_page2_ofs]\n" // Y = buffer page 2 offset
-      //   "loop_y:\n"
-      //   "loop_x:\n"
-      //   // load bitmap and mask data
-      //   "lpm %A[bitmap_data], Z+\n"
-      //   "lpm %A[mask_data], Z+\n"
-
-      //   // shift mask and buffer data
-      //   "tst %[yOffset]\n"
-      //   "breq skip_shifting\n"
-      //   "mul %A[bitmap_data], %[mul_amt]\n"
-      //   "movw %[bitmap_data], r0\n"
-      //   "mul %A[mask_data], %[mul_amt]\n"
-      //   "movw %[mask_data], r0\n"
-
-
-      //   // SECOND PAGE
-      //   // if yOffset != 0 && sRow < 7
-      //   "cpi %[sRow], 7\n"
-      //   "brge end_second_page\n"
-      //   // then
-      //   "ld %[data], Y\n"
-      //   "com %B[mask_data]\n" // invert high byte of mask
-      //   "and %[data], %B[mask_data]\n"
-      //   "or %[data], %B[bitmap_data]\n"
-      //   // update buffer, increment
-      //   "st Y+, %[data]\n"
-
-      //   "end_second_page:\n"
-      //   "skip_shifting:\n"
-
-
-      //   // FIRST PAGE
-      //   // if sRow >= 0
-      //   "tst %[sRow]\n"
-      //   "brmi skip_first_page\n"
-      //   "ld %[data], %a[buffer_ofs]\n"
-      //   // then
-      //   "com %A[mask_data]\n"
-      //   "and %[data], %A[mask_data]\n"
-      //   "or %[data], %A[bitmap_data]\n"
-      //   // update buffer, increment
-      //   "st %a[buffer_ofs]+, %[data]\n"
-      //   "jmp end_first_page\n"
-
-      //   "skip_first_page:\n"
-      //   // since no ST Z+ when skipped we need to do this manually
-      //   "adiw %[buffer_ofs], 1\n"
-
-      //   "end_first_page:\n"
-
-      //   // "x_loop_next:\n"
-      //   "dec %[xi]\n"
-      //   "brne loop_x\n"
-
-      //   // increment y
-      //   "next_loop_y:\n"
-      //   "dec %[yi]\n"
-      //   "breq finished\n"
-      //   "mov %[xi], %[x_count]\n" // reset x counter
-      //   // sRow++;
-      //   "inc %[sRow]\n"
-      //   "clr __zero_reg__\n"
-      //   // sprite_ofs += (w - rendered_width) * 2;
-      //   "add %A[sprite_ofs], %A[sprite_ofs_jump]\n"
-      //   "adc %B[sprite_ofs], __zero_reg__\n"
-      //   // buffer_ofs += WIDTH - rendered_width;
-      //   "add %A[buffer_ofs], %A[buffer_ofs_jump]\n"
-      //   "adc %B[buffer_ofs], __zero_reg__\n"
-      //   // buffer_ofs_page_2 += WIDTH - rendered_width;
-      //   "add r28, %A[buffer_ofs_jump]\n"
-      //   "adc r29, __zero_reg__\n"
-
-      //   "rjmp loop_y\n"
-      //   "finished:\n"
-      //   // put the Y register back in place
-      //   "pop r29\n"
-      //   "pop r28\n"
-      //   "clr __zero_reg__\n" // just in case
-      //   : [xi] "+&r" (xi),
-      //   [yi] "+&r" (yi),
-      //   [sRow] "+&d" (sRow), // CPI requires an upper register
-      //   [data] "=&r" (data),
-      //   [mask_data] "=&r" (mask_data),
-      //   [bitmap_data] "=&r" (bitmap_data)
-      //   :
-      //   [x_count] "r" (rendered_width),
-      //   [y_count] "r" (loop_h),
-      //   [sprite_ofs] "z" (bofs),
-      //   [buffer_ofs] "x" (MicroGamerBase::sBuffer+ofs),
-      //   [buffer_page2_ofs] "r" (MicroGamerBase::sBuffer+ofs+WIDTH), // Y pointer
-      //   [buffer_ofs_jump] "r" (WIDTH-rendered_width),
-      //   [sprite_ofs_jump] "r" ((w-rendered_width)*2),
-      //   [yOffset] "r" (yOffset),
-      //   [mul_amt] "r" (mul_amt)
-      //   // declaring an extra high register clobber here for some reason
-      //   // prevents a compile error for some sketches:
-      //   // can't find a register in class 'LD_REGS' while reloading 'asm'
-      //   : "r24"
-      // );
+      drawBitmapMode<SPRITE_PLUS_MASK>(x, y, bitmap, mask, w, h);
       break;
   }
 }
+
+void Sprites::drawTransformed(int16_t x, int16_t y,
+                              const uint8_t *bitmap, uint8_t frame,
+                              const uint8_t *mask, uint8_t mask_frame,
+                              uint8_t drawMode, uint8_t transform,
+                              uint8_t scale)
+{
+  if (bitmap == NULL || scale < 1 || scale > 4)
+    return;
+  if (drawMode == SPRITE_MASKED && mask == NULL)
+    return;
+  if (transform == 0 && scale == 1) {
+    draw(x, y, bitmap, frame, mask, mask_frame, drawMode);
+    return;
+  }
+
+  uint8_t w = pgm_read_byte(bitmap);
+  uint8_t h = pgm_read_byte(bitmap + 1);
+  bool rotate = transform & SPRITE_ROTATE_90;
+  uint16_t width = (rotate ? h : w) * scale;
+  uint16_t height = (rotate ? w : h) * scale;
+  uint8_t bands = (height + 7) / 8;
+
+  if (width > 255 || height > 255)
+    return;
+
+  // no need to draw at all if we're outside of the clip rectangle
+  if (MicroGamerBase::clippedOut(x, y, width, height))
+    return;
+
+  int16_t args[] = { x, y, frame, mask_frame, drawMode, transform, scale };
+  if (MicroGamerBase::recordDrawCall(MicroGamerBase::DL_SPRITES_DRAW_TRANSFORMED,
+                                     y, y + (bands * 8) - 1, args, 7,
+                                     bitmap, mask))
+    return;
+
+  uint16_t frame_size = w * ((h + 7) / 8);
+  const uint8_t *image = bitmap + 2 +
+    frame * frame_size * (drawMode == SPRITE_PLUS_MASK ? 2 : 1);
+  const uint8_t *maskPlane = NULL;
+  uint8_t stride = 1;
+
+  // the image and mask are transformed separately and drawn as if they
+  // came from separate arrays
+  if (drawMode == SPRITE_PLUS_MASK) {
+    maskPlane = image + 1;
+    stride = 2;
+    drawMode = SPRITE_MASKED;
+  }
+  else if (drawMode == SPRITE_MASKED) {
+    maskPlane = mask + mask_frame * frame_size;
+  }
+
+  // the columns of the result that are in the clip area, and its top row
+  // in target coordinates
+  int16_t left = x + MicroGamerBase::view.originX;
+  int16_t top = y + MicroGamerBase::view.originY;
+  int16_t first = (left < MicroGamerBase::clipLeft) ?
+                  MicroGamerBase::clipLeft - left : 0;
+  int16_t end = (left + width > MicroGamerBase::clipRight) ?
+                MicroGamerBase::clipRight - left : width;
+  const uint16_t *expand = (scale > 1) ?
+                           MicroGamerBase::expandedNibbles[scale - 2] : NULL;
+  uint8_t imageBand[255];
+  uint8_t maskBand[255];
+
+  for (uint8_t band = 0; band < bands; band++) {
+    int16_t bandY = y + (band * 8);
+
+    if (top + (band * 8) + 8 <= MicroGamerBase::clipTop ||
+        top + (band * 8) >= MicroGamerBase::clipBottom)
+      continue;
+
+    transformBand(imageBand, image, stride, w, h, transform, scale, expand,
+                  band, first, end);
+    if (maskPlane != NULL) {
+      transformBand(maskBand, maskPlane, stride, w, h, transform, scale,
+                    expand, band, first, end);
+    }
+    drawBitmap(x + first, bandY, imageBand,
+               (maskPlane != NULL) ? maskBand : NULL, end - first,
+               (height - (band * 8) < 8) ? height - (band * 8) : 8,
+               drawMode);
+  }
+}
@@ -17,6 +17,12 @@
 #define SPRITE_IS_MASK_ERASE 251
 #define SPRITE_AUTO_MODE 255
 
+#define SPRITE_MIRROR 0x01     /**< Transform: mirror left to right. */
+#define SPRITE_FLIP 0x02       /**< Transform: flip upside down. */
+#define SPRITE_ROTATE_90 0x04  /**< Transform: rotate a quarter turn clockwise. */
+#define SPRITE_ROTATE_180 (SPRITE_MIRROR | SPRITE_FLIP) /**< Transform: rotate a half turn. */
+#define SPRITE_ROTATE_270 (SPRITE_ROTATE_90 | SPRITE_MIRROR | SPRITE_FLIP) /**< Transform: rotate a quarter turn anticlockwise. */
+
 /** \brief
  * A class for drawing animated sprites from image and mask bitmaps.
  *
@@ -49,6 +55,16 @@
  *
  * Data for each frame after the first one immediately follows the previous
  * frame. Frame numbers start at 0.
+ *
+ * When the array is in the same file as the call and the width and height
+ * are 8, 16, 24 or 32, `drawExternalMask()`, `drawPlusMask()`,
+ * `drawOverwrite()`, `drawErase()` and `drawSelfMasked()` are compiled as
+ * `draw<Mode, W, H>()` for that size, with optimization on. Other sprites
+ * are drawn by code that reads the width and height from the array.
+ *
+ * Each drawing function also has a version taking a transform and a scale,
+ * which draws the frame mirrored, flipped, rotated or made larger, so those
+ * variants don't have to be stored in the array.
  */
 class Sprites
 {
@@ -87,8 +103,12 @@ class Sprites
      *     ..O..  OOOOO  OOOOO   ..O..
      *     .....  .OOO.  OOOOO   O...O
      */
-    static void drawExternalMask(int16_t x, int16_t y, const uint8_t *bitmap,
-                                 const uint8_t *mask, uint8_t frame, uint8_t mask_frame);
+    static inline __attribute__((always_inline))
+    void drawExternalMask(int16_t x, int16_t y, const uint8_t *bitmap,
+                          const uint8_t *mask, uint8_t frame, uint8_t mask_frame)
+    {
+      drawNamed<SPRITE_MASKED>(x, y, bitmap, frame, mask, mask_frame);
+    }
 
     /** \brief
      * Draw a sprite using an array containing both image and mask values.
@@ -124,7 +144,11 @@ class Sprites
      *     ..O..  OOOOO  OOOOO   ..O..
      *     .....  .OOO.  OOOOO   O...O
      */
-    static void drawPlusMask(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame);
+    static inline __attribute__((always_inline))
+    void drawPlusMask(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame)
+    {
+      drawNamed<SPRITE_PLUS_MASK>(x, y, bitmap, frame, NULL, 0);
+    }
 
     /** \brief
      * Draw a sprite by replacing the existing content completely.
@@ -155,7 +179,11 @@ class Sprites
      *     ..O..  OOOOO   ..O..
      *     .....  OOOOO   .....
      */
-    static void drawOverwrite(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame);
+    static inline __attribute__((always_inline))
+    void drawOverwrite(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame)
+    {
+      drawNamed<SPRITE_OVERWRITE>(x, y, bitmap, frame, NULL, 0);
+    }
 
     /** \brief
      * "Erase" a sprite.
@@ -186,7 +214,11 @@ class Sprites
      *     ..O..  OOOOO   OO.OO
      *     .....  OOOOO   OOOOO
      */
-    static void drawErase(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame);
+    static inline __attribute__((always_inline))
+    void drawErase(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame)
+    {
+      drawNamed<SPRITE_IS_MASK_ERASE>(x, y, bitmap, frame, NULL, 0);
+    }
 
     /** \brief
      * Draw a sprite using only the bits set to 1.
@@ -216,7 +248,167 @@ class Sprites
      *     ..O..  OOOOO   OOOOO
      *     .....  OOOOO   OOOOO
      */
-    static void drawSelfMasked(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame);
+    static inline __attribute__((always_inline))
+    void drawSelfMasked(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame)
+    {
+      drawNamed<SPRITE_IS_MASK>(x, y, bitmap, frame, NULL, 0);
+    }
+
+    /** \brief
+     * Draw a sprite mirrored, flipped, rotated or scaled, using a separate
+     * image and mask array.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param mask A pointer to the array containing the mask frames.
+     * \param frame The frame number of the image to draw.
+     * \param mask_frame The frame number for the mask to use.
+     * \param transform The transform, as for the transformed `drawOverwrite()`.
+     * \param scale The size to draw the sprite at, from 1 to 4.
+     *
+     * \see drawOverwrite(int16_t, int16_t, const uint8_t*, uint8_t, uint8_t, uint8_t)
+     */
+    static void drawExternalMask(int16_t x, int16_t y, const uint8_t *bitmap,
+                                 const uint8_t *mask, uint8_t frame, uint8_t mask_frame,
+                                 uint8_t transform, uint8_t scale = 1);
+
+    /** \brief
+     * Draw a sprite mirrored, flipped, rotated or scaled, using an array
+     * containing both image and mask values.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image/mask frames.
+     * \param frame The frame number of the image to draw.
+     * \param transform The transform, as for the transformed `drawOverwrite()`.
+     * \param scale The size to draw the sprite at, from 1 to 4.
+     *
+     * \see drawOverwrite(int16_t, int16_t, const uint8_t*, uint8_t, uint8_t, uint8_t)
+     */
+    static void drawPlusMask(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                             uint8_t transform, uint8_t scale = 1);
+
+    /** \brief
+     * Draw a sprite mirrored, flipped, rotated or scaled, by replacing the
+     * existing content completely.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param frame The frame number of the image to draw.
+     * \param transform `SPRITE_MIRROR`, `SPRITE_FLIP` or both, or one of
+     * `SPRITE_ROTATE_90`, `SPRITE_ROTATE_180` or `SPRITE_ROTATE_270`. 0 draws
+     * the sprite as it's stored.
+     * \param scale The size to draw the sprite at, from 1 to 4. Each pixel is
+     * drawn as a square of `scale` by `scale` pixels.
+     *
+     * \details
+     * The frame is drawn as with `drawOverwrite()`, with the transform
+     * applied and then scaled. The top left of the result is drawn at `x`,
+     * `y`. A rotation by a quarter turn swaps the width and height. The
+     * width and height of the result can't be more than 255.
+     *
+     * The result is worked out one page row at a time, just before it's
+     * drawn. Columns are mirrored by reading them in reverse order, page
+     * bytes are flipped with a table of reversed bytes, rotations turn
+     * blocks of 8 by 8 pixels with a bit matrix transpose and pixels are
+     * scaled up with a table of expanded nibbles. Only the columns on the
+     * display are worked out.
+     *
+     * \code
+     * // the player faces the way it's moving
+     * Sprites::drawSelfMasked(x, y, player, frame,
+     *                         facingLeft ? SPRITE_MIRROR : 0);
+     * // the boss at twice the size
+     * Sprites::drawPlusMask(bossX, bossY, boss, 0, 0, 2);
+     * \endcode
+     *
+     * \see drawOverwrite(int16_t, int16_t, const uint8_t*, uint8_t)
+     */
+    static void drawOverwrite(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                              uint8_t transform, uint8_t scale = 1);
+
+    /** \brief
+     * "Erase" a sprite mirrored, flipped, rotated or scaled.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param frame The frame number of the image to erase.
+     * \param transform The transform, as for the transformed `drawOverwrite()`.
+     * \param scale The size to draw the sprite at, from 1 to 4.
+     *
+     * \see drawOverwrite(int16_t, int16_t, const uint8_t*, uint8_t, uint8_t, uint8_t)
+     */
+    static void drawErase(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                          uint8_t transform, uint8_t scale = 1);
+
+    /** \brief
+     * Draw a sprite mirrored, flipped, rotated or scaled, using only the bits
+     * set to 1.
+     *
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames.
+     * \param frame The frame number of the image to draw.
+     * \param transform The transform, as for the transformed `drawOverwrite()`.
+     * \param scale The size to draw the sprite at, from 1 to 4.
+     *
+     * \see drawOverwrite(int16_t, int16_t, const uint8_t*, uint8_t, uint8_t, uint8_t)
+     */
+    static void drawSelfMasked(int16_t x, int16_t y, const uint8_t *bitmap, uint8_t frame,
+                               uint8_t transform, uint8_t scale = 1);
+
+    /** \brief
+     * Draw a sprite with a draw mode and dimensions known at compile time.
+     *
+     * \tparam Mode The draw mode: `SPRITE_MASKED`, `SPRITE_UNMASKED`
+     * (`SPRITE_OVERWRITE`), `SPRITE_PLUS_MASK`, `SPRITE_IS_MASK` or
+     * `SPRITE_IS_MASK_ERASE`.
+     * \tparam W,H The width and height of the sprite. They must be the same
+     * as the values at the start of the image array.
+     * \param x,y The coordinates of the top left pixel location.
+     * \param bitmap A pointer to the array containing the image frames,
+     * starting with the width and height.
+     * \param frame The frame number of the image to draw.
+     * \param mask A pointer to the array containing the mask frames. Only
+     * used with `SPRITE_MASKED`.
+     * \param mask_frame The frame number for the mask to use.
+     *
+     * \details
+     * The sprite is drawn the same as with the function for the draw mode,
+     * such as `drawPlusMask()` for `SPRITE_PLUS_MASK`, but the width and
+     * height aren't read from the array, the offset of the frame is worked
+     * out by the compiler and only the code for the draw mode is included.
+     * Sprites at a `y` that's a multiple of 8 are drawn without shifting.
+     *
+     * Each combination of draw mode, width and height that's used adds its
+     * own copy of the drawing code to the sketch. The named functions, such
+     * as `drawPlusMask()`, use this function for sprites whose size they
+     * can read when the sketch is compiled, if it's one of the sizes listed
+     * in the class description.
+     *
+     * \code
+     * Sprites::draw<SPRITE_PLUS_MASK, 16, 16>(x, y, player, frame);
+     * Sprites::draw<SPRITE_MASKED, 8, 8>(x, y, enemy, frame, enemyMask, frame);
+     * \endcode
+     *
+     * \see drawExternalMask() drawPlusMask() drawOverwrite() drawErase()
+     * drawSelfMasked()
+     */
+    template<uint8_t Mode, uint8_t W, uint8_t H>
+    static void draw(int16_t x, int16_t y, const uint8_t *bitmap,
+                     uint8_t frame, const uint8_t *mask = NULL,
+                     uint8_t mask_frame = 0)
+    {
+      static_assert(Mode == SPRITE_MASKED || Mode == SPRITE_UNMASKED ||
+                    Mode == SPRITE_PLUS_MASK || Mode == SPRITE_IS_MASK ||
+                    Mode == SPRITE_IS_MASK_ERASE, "unknown sprite draw mode");
+
+      const uint16_t frame_size = W * ((H + 7) / 8);
+
+      bitmap += 2 + frame * frame_size * (Mode == SPRITE_PLUS_MASK ? 2 : 1);
+      if (Mode == SPRITE_MASKED) {
+        mask += mask_frame * frame_size;
+      }
+      renderBitmap<Mode>(x, y, bitmap, mask, W, H);
+    }
 
     // Master function. Needs to be abstracted into separate function for
     // every render type.
@@ -230,6 +422,236 @@ class Sprites
     static void drawBitmap(int16_t x, int16_t y,
                            const uint8_t *bitmap, const uint8_t *mask,
                            uint8_t w, uint8_t h, uint8_t draw_mode);
+
+    // The drawing code of the transformed draw functions
+    // (Not officially part of the API)
+    static void drawTransformed(int16_t x, int16_t y,
+                                const uint8_t *bitmap, uint8_t frame,
+                                const uint8_t *mask, uint8_t mask_frame,
+                                uint8_t drawMode, uint8_t transform,
+                                uint8_t scale);
+
+  private:
+    // The pages a row of a sprite is drawn on, for drawRow()
+    enum RowPages {
+      ROW_TOP = 1,    // the page of the row
+      ROW_BOTTOM = 2, // the page below it, for a row that isn't page aligned
+      ROW_BOTH = 3
+    };
+
+    // The named draw functions. When the width and height at the start of
+    // the array are known to the compiler and are one of the sizes below,
+    // the sprite is drawn by draw<Mode, W, H>(), which is shared by the
+    // calls for that size. Otherwise it's drawn by drawFrame<Mode>().
+    template<uint8_t Mode>
+    static inline __attribute__((always_inline))
+    void drawNamed(int16_t x, int16_t y,
+                   const uint8_t *bitmap, uint8_t frame,
+                   const uint8_t *mask, uint8_t mask_frame)
+    {
+      if (__builtin_constant_p(pgm_read_byte(bitmap)) &&
+          __builtin_constant_p(pgm_read_byte(bitmap + 1))) {
+        switch ((pgm_read_byte(bitmap) << 8) | pgm_read_byte(bitmap + 1)) {
+#define SPRITES_DRAW_SIZE(w, h) \
+          case (w << 8) | h: \
+            draw<Mode, w, h>(x, y, bitmap, frame, mask, mask_frame); \
+            return;
+          SPRITES_DRAW_SIZE(8, 8)   SPRITES_DRAW_SIZE(8, 16)
+          SPRITES_DRAW_SIZE(8, 24)  SPRITES_DRAW_SIZE(8, 32)
+          SPRITES_DRAW_SIZE(16, 8)  SPRITES_DRAW_SIZE(16, 16)
+          SPRITES_DRAW_SIZE(16, 24) SPRITES_DRAW_SIZE(16, 32)
+          SPRITES_DRAW_SIZE(24, 8)  SPRITES_DRAW_SIZE(24, 16)
+          SPRITES_DRAW_SIZE(24, 24) SPRITES_DRAW_SIZE(24, 32)
+          SPRITES_DRAW_SIZE(32, 8)  SPRITES_DRAW_SIZE(32, 16)
+          SPRITES_DRAW_SIZE(32, 24) SPRITES_DRAW_SIZE(32, 32)
+#undef SPRITES_DRAW_SIZE
+        }
+      }
+      drawFrame<Mode>(x, y, bitmap, frame, mask, mask_frame);
+    }
+
+    // Draw a frame of a sprite, reading its width and height from the array.
+    // Defined in Sprites.cpp for each draw mode.
+    template<uint8_t Mode>
+    static void drawFrame(int16_t x, int16_t y,
+                          const uint8_t *bitmap, uint8_t frame,
+                          const uint8_t *mask, uint8_t mask_frame);
+
+    // drawBitmap() for a draw mode, shared by drawBitmap() and drawFrame()
+    template<uint8_t Mode>
+    static void drawBitmapMode(int16_t x, int16_t y,
+                               const uint8_t *bitmap, const uint8_t *mask,
+                               uint8_t w, uint8_t h)
+    {
+      renderBitmap<Mode>(x, y, bitmap, mask, w, h);
+    }
+
+    // The drawing code of drawBitmap() for a draw mode. It's inlined in the
+    // callers so that, for draw<Mode, W, H>(), the compiler can work with the
+    // constant width and height.
+    template<uint8_t Mode>
+    static inline __attribute__((always_inline))
+    void renderBitmap(int16_t x, int16_t y,
+                      const uint8_t *bitmap, const uint8_t *mask,
+                      uint8_t w, uint8_t h)
+    {
+      // bytes of the array for each byte drawn
+      const uint8_t stride = (Mode == SPRITE_PLUS_MASK) ? 2 : 1;
+      // the sprite is drawn as whole pages, even past its height
+      const uint8_t rows = (h + 7) / 8;
+
+      // no need to draw at all if we're outside of the clip rectangle
+      if (MicroGamerBase::clippedOut(x, y, w, h))
+        return;
+
+      if (bitmap == NULL)
+        return;
+
+      int16_t args[] = { x, y, w, h, Mode };
+      if (MicroGamerBase::recordDrawCall(MicroGamerBase::DL_SPRITES_DRAW_BITMAP,
+                                         y, y + (rows * 8) - 1, args, 5,
+                                         bitmap, mask))
+        return;
+
+      // the sprite is clipped and drawn in target coordinates
+      x += MicroGamerBase::view.originX;
+      y += MicroGamerBase::view.originY;
+
+      // the pages that can be drawn on
+      int16_t firstPage = MicroGamerBase::clipTop / 8;
+      int16_t lastPage = (MicroGamerBase::clipBottom - 1) / 8;
+
+      if (y + (rows * 8) <= firstPage * 8 || y >= (lastPage + 1) * 8)
+        return;
+
+      // the columns of the sprite that are in the clip area
+      int16_t left = MicroGamerBase::clipLeft;
+      int16_t right = MicroGamerBase::clipRight;
+      uint8_t xOffset = (x < left) ? left - x : 0;
+      int16_t visible = ((x + w > right) ? right - x : w) - xOffset;
+      int16_t width = MicroGamerBase::targetWidth;
+
+      if (visible <= 0)
+        return;
+
+      MicroGamerBase::markDirty(x, y, w, rows * 8);
+
+      // the page of the first row, which can be above the display
+      uint8_t yOffset = y & 7;
+      int16_t sRow = (y - yOffset) / 8;
+
+      // the rows of the sprite drawn on the pages that can be drawn on
+      int16_t firstRow = 0;
+      int16_t endRow = rows;
+      if (sRow < firstPage - 1) {
+        firstRow = (firstPage - 1) - sRow;
+      }
+      if (sRow + endRow > lastPage + 1) {
+        endRow = (lastPage + 1) - sRow;
+      }
+
+      // When the clip area starts or ends inside a page, the sprite is drawn
+      // in runs of columns, and the rows of that page outside of the clip
+      // area are put back after each run.
+      bool partial = MicroGamerBase::clipEdgesPartial();
+      MicroGamerBase::ClipEdges edges;
+      uint8_t *sBuffer = MicroGamerBase::sBuffer;
+      uint8_t done = 0;
+
+      while (done < visible) {
+        uint8_t count = visible - done;
+        int16_t column = x + xOffset + done;
+
+        if (partial) {
+          if (count > MicroGamerBase::CLIP_EDGE_COLUMNS)
+            count = MicroGamerBase::CLIP_EDGE_COLUMNS;
+          MicroGamerBase::clipEdgesSave(&edges, column, count);
+        }
+
+        const uint8_t *image =
+          bitmap + ((firstRow * w) + xOffset + done) * stride;
+        const uint8_t *maskRow = (Mode == SPRITE_MASKED) ?
+                                 mask + (firstRow * w) + xOffset + done : NULL;
+
+        for (int16_t row = firstRow; row < endRow; row++) {
+          int16_t page = sRow + row;
+          int32_t ofs = ((int32_t)page * width) + column;
+
+          if (yOffset == 0) {
+            if (page >= firstPage) {
+              drawRow<Mode, ROW_TOP>(sBuffer + ofs, image, maskRow, count, 0);
+            }
+          }
+          else if (page < firstPage) {
+            drawRow<Mode, ROW_BOTTOM>(sBuffer + ofs + width, image, maskRow,
+                                      count, yOffset);
+          }
+          else if (page == lastPage) {
+            drawRow<Mode, ROW_TOP>(sBuffer + ofs, image, maskRow,
+                                   count, yOffset);
+          }
+          else {
+            drawRow<Mode, ROW_BOTH>(sBuffer + ofs, image, maskRow,
+                                    count, yOffset);
+          }
+          image += w * stride;
+          maskRow += (Mode == SPRITE_MASKED) ? w : 0;
+        }
+
+        if (partial)
+          MicroGamerBase::clipEdgesRestore(&edges);
+        done += count;
+      }
+    }
+
+    // Draw count bytes of a row of a sprite, shifted down by shift bits,
+    // starting at dst. With ROW_BOTTOM, dst is on the page below the row.
+    template<uint8_t Mode, uint8_t Pages>
+    static inline __attribute__((always_inline))
+    void drawRow(uint8_t *dst, const uint8_t *image, const uint8_t *mask,
+                 uint8_t count, uint8_t shift)
+    {
+      const int16_t width = MicroGamerBase::targetWidth;
+
+      for (; count != 0; count--) {
+        uint16_t image_data = pgm_read_byte(image) << shift;
+        uint16_t mask_data = 0;
+
+        if (Mode == SPRITE_UNMASKED) {
+          mask_data = 0xFF << shift;
+        } else if (Mode == SPRITE_MASKED) {
+          mask_data = pgm_read_byte(mask) << shift;
+          mask++;
+        } else if (Mode == SPRITE_PLUS_MASK) {
+          mask_data = pgm_read_byte(image + 1) << shift;
+        }
+        image += (Mode == SPRITE_PLUS_MASK) ? 2 : 1;
+
+        if (Pages & ROW_TOP) {
+          blendByte<Mode>(dst, image_data, mask_data);
+        }
+        if (Pages == ROW_BOTH) {
+          blendByte<Mode>(dst + width, image_data >> 8, mask_data >> 8);
+        } else if (Pages == ROW_BOTTOM) {
+          blendByte<Mode>(dst, image_data >> 8, mask_data >> 8);
+        }
+        dst++;
+      }
+    }
+
+    // Draw a byte of a sprite on the buffer byte at dst
+    template<uint8_t Mode>
+    static inline __attribute__((always_inline))
+    void blendByte(uint8_t *dst, uint8_t image, uint8_t mask)
+    {
+      if (Mode == SPRITE_IS_MASK) {
+        *dst |= image;
+      } else if (Mode == SPRITE_IS_MASK_ERASE) {
+        *dst &= ~image;
+      } else {
+        *dst = (*dst & ~mask) | image;
+      }
+    }
 };
 
 #endif